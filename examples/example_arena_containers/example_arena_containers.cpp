@@ -0,0 +1,97 @@
+// define HSA implemntation
+#define HSA_IMPLEMENTATION
+// include hsa.h
+#include <hsa.h>
+
+#include <chrono>
+#include <cstdio>
+#include <unordered_map>
+#include <vector>
+
+/*
+This example builds a per request index in a linear allocator, once with std containers and once with Vector and FlatHashMap.
+std::vector leaves every old buffer behind in the arena and std::unordered_map allocates a node for every element.
+Vector grows in place when it is the last allocation of the arena. FlatHashMap keeps all elements in one table.
+*/
+
+using Clock = std::chrono::high_resolution_clock;
+
+const size_t row_count = 100 * 1000;
+const size_t request_count = 20;
+
+template<class T>
+using ArenaVector = std::vector<T, STLAllocatorWrapper<T>>;
+using ArenaMap = std::unordered_map<uint64_t, uint32_t, std::hash<uint64_t>, std::equal_to<uint64_t>, STLAllocatorWrapper<std::pair<const uint64_t, uint32_t>>>;
+
+double BenchmarkStd( size_t& arg_used )
+{
+	Clock::time_point start = Clock::now();
+	uint64_t checksum = 0;
+	for( size_t request = 0; request < request_count; request++ )
+	{
+		LinearAllocator request_arena( MIBI( 64 ) );
+		STLAllocatorWrapper<uint64_t> id_allocator( &request_arena );
+		STLAllocatorWrapper<std::pair<const uint64_t, uint32_t>> map_allocator( &request_arena );
+		ArenaVector<uint64_t> ids( id_allocator );
+		ArenaMap rows( 0, std::hash<uint64_t>(), std::equal_to<uint64_t>(), map_allocator );
+		for( size_t i = 0; i < row_count; i++ )
+		{
+			ids.push_back( i * 2654435761u );
+		}
+		for( size_t i = 0; i < row_count; i++ )
+		{
+			rows[ids[i]] = static_cast< uint32_t >( i );
+		}
+		for( size_t i = 0; i < row_count; i++ )
+		{
+			checksum += rows.find( ids[i] )->second;
+		}
+		// ids is the first allocation of the arena, the next allocation shows how much of the arena is used.
+		arg_used = reinterpret_cast< char* >( request_arena.Allocate( 1 ) ) - reinterpret_cast< char* >( ids.data() );
+	}
+	printf( "  checksum %llu\n", static_cast< unsigned long long >( checksum ) );
+	return std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+}
+
+double BenchmarkNative( size_t& arg_used )
+{
+	Clock::time_point start = Clock::now();
+	uint64_t checksum = 0;
+	for( size_t request = 0; request < request_count; request++ )
+	{
+		LinearAllocator request_arena( MIBI( 64 ) );
+		Vector<uint64_t> ids( &request_arena );
+		for( size_t i = 0; i < row_count; i++ )
+		{
+			ids.PushBack( i * 2654435761u );
+		}
+		// the index size is known, reserve it so the table is allocated once.
+		FlatHashMap<uint64_t, uint32_t> rows( &request_arena, row_count );
+		for( size_t i = 0; i < row_count; i++ )
+		{
+			rows.Insert( ids[i], static_cast< uint32_t >( i ) );
+		}
+		for( size_t i = 0; i < row_count; i++ )
+		{
+			checksum += *rows.Find( ids[i] );
+		}
+		arg_used = reinterpret_cast< char* >( request_arena.Allocate( 1 ) ) - reinterpret_cast< char* >( ids.Data() );
+	}
+	printf( "  checksum %llu\n", static_cast< unsigned long long >( checksum ) );
+	return std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+}
+
+int main( int arg_n, char** arg_s )
+{
+	size_t std_used = 0;
+	size_t native_used = 0;
+	double std_time = BenchmarkStd( std_used );
+	double native_time = BenchmarkNative( native_used );
+
+	printf( "%zu requests, %zu rows per request\n", request_count, row_count );
+	printf( "  std::vector + std::unordered_map: %8.2f ms %10zu bytes per request\n", std_time, std_used );
+	printf( "  Vector + FlatHashMap:             %8.2f ms %10zu bytes per request\n", native_time, native_used );
+
+	std::getchar();
+	return 0;
+}
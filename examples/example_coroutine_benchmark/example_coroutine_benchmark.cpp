@@ -0,0 +1,162 @@
+// define HSA implemntation
+#define HSA_IMPLEMENTATION
+// include hsa.h
+#include <hsa.h>
+
+#include <chrono>
+#include <coroutine>
+#include <cstdio>
+#include <thread>
+
+/*
+This example compares coroutine frame allocation with the global operator new, the thread local size class pool
+and the thread local stack. requires c++20.
+every benchmark creates and destroys a million short lived coroutines.
+it also checks that a coroutine can be destroyed by a thread local object after the frame cache of the thread is gone.
+*/
+
+using Clock = std::chrono::high_resolution_clock;
+
+struct DefaultFrame
+{
+};
+
+// a task that starts suspended. the caller resumes it once and destroys it.
+template<class FrameBase>
+struct Task
+{
+	struct promise_type : FrameBase
+	{
+		Task get_return_object()
+		{
+			return Task{ std::coroutine_handle<promise_type>::from_promise( *this ) };
+		}
+		std::suspend_always initial_suspend() noexcept
+		{
+			return {};
+		}
+		std::suspend_always final_suspend() noexcept
+		{
+			return {};
+		}
+		void return_value( int arg_value )
+		{
+			value_ = arg_value;
+		}
+		void unhandled_exception()
+		{
+		}
+		int value_ = 0;
+	};
+
+	std::coroutine_handle<promise_type> handle_;
+};
+
+template<class FrameBase>
+Task<FrameBase> Work( int arg_value )
+{
+	int buffer[32]; // makes the frame a bit bigger, like a coroutine with some local state.
+	for( int i = 0; i < 32; i++ )
+	{
+		buffer[i] = arg_value + i;
+	}
+	co_return buffer[arg_value % 32];
+}
+
+const size_t coroutine_count = 1000 * 1000;
+const size_t batch_size = 1000;
+
+// keeps batch_size coroutines alive at the same time, like requests waiting for I/O.
+template<class FrameBase>
+double BenchmarkBatches()
+{
+	static std::coroutine_handle<typename Task<FrameBase>::promise_type> handles[batch_size];
+	long long sum = 0;
+	Clock::time_point start = Clock::now();
+	for( size_t batch = 0; batch < coroutine_count / batch_size; batch++ )
+	{
+		for( size_t i = 0; i < batch_size; i++ )
+		{
+			handles[i] = Work<FrameBase>( static_cast< int >( i ) ).handle_;
+		}
+		for( size_t i = 0; i < batch_size; i++ )
+		{
+			handles[i].resume();
+			sum += handles[i].promise().value_;
+			handles[i].destroy();
+		}
+	}
+	double time = std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+	printf( "  checksum %lld\n", sum );
+	return time;
+}
+
+// destroys every coroutine before the next one is created. works with the stack mode.
+template<class FrameBase>
+double BenchmarkNested()
+{
+	long long sum = 0;
+	Clock::time_point start = Clock::now();
+	for( size_t i = 0; i < coroutine_count; i++ )
+	{
+		auto handle = Work<FrameBase>( static_cast< int >( i ) ).handle_;
+		handle.resume();
+		sum += handle.promise().value_;
+		handle.destroy();
+	}
+	double time = std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+	printf( "  checksum %lld\n", sum );
+	return time;
+}
+
+using PoolTask = Task<CoroutineFrameAllocator<CoroutineFramePool>>;
+
+// a thread local that is constructed before the frame cache of its thread, so it is destroyed after it.
+struct ThreadLocalTask
+{
+	~ThreadLocalTask()
+	{
+		if( handle_ )
+		{
+			handle_.destroy(); // freed after the frame cache was orphaned.
+		}
+		auto late = Work<CoroutineFrameAllocator<CoroutineFramePool>>( 7 ).handle_; // allocated after the frame cache was orphaned.
+		late.resume();
+		HSA_ASSERT( late.promise().value_ == 14 );
+		late.destroy();
+	}
+	std::coroutine_handle<PoolTask::promise_type> handle_;
+};
+
+void CheckThreadExit()
+{
+	std::thread worker( []
+	{
+		thread_local ThreadLocalTask thread_task;
+		thread_task.handle_ = Work<CoroutineFrameAllocator<CoroutineFramePool>>( 1 ).handle_;
+	} );
+	worker.join();
+	printf( "thread exit ok\n" );
+}
+
+int main( int arg_n, char** arg_s )
+{
+	CheckThreadExit();
+
+	printf( "%zu coroutines, %zu alive at the same time\n", coroutine_count, batch_size );
+	double default_time = BenchmarkBatches<DefaultFrame>();
+	double pool_time = BenchmarkBatches<CoroutineFrameAllocator<CoroutineFramePool>>();
+	printf( "  operator new:       %8.2f ms\n", default_time );
+	printf( "  CoroutineFramePool: %8.2f ms\n", pool_time );
+
+	printf( "%zu coroutines, one alive at a time\n", coroutine_count );
+	default_time = BenchmarkNested<DefaultFrame>();
+	pool_time = BenchmarkNested<CoroutineFrameAllocator<CoroutineFramePool>>();
+	double stack_time = BenchmarkNested<CoroutineFrameAllocator<CoroutineFrameStack>>();
+	printf( "  operator new:        %8.2f ms\n", default_time );
+	printf( "  CoroutineFramePool:  %8.2f ms\n", pool_time );
+	printf( "  CoroutineFrameStack: %8.2f ms\n", stack_time );
+
+	std::getchar();
+	return 0;
+}
@@ -0,0 +1,59 @@
+// define HSA implemntation
+#define HSA_IMPLEMENTATION
+// include hsa.h
+#include <hsa.h>
+
+#include <cstdio>
+#include <list>
+#include <vector>
+
+/*
+This example shows which containers fill a free list allocator.
+HeapProfiler is an Allocator that samples the allocations of another allocator and keeps the call stack of every live sample.
+the containers use the profiler through the STLAllocatorWrapper.
+the folded stacks can be turned into a flame graph, for example with flamegraph.pl. use addr2line or atos to get function names.
+*/
+
+typedef std::vector<int, STLAllocatorWrapper<int>> IntVector;
+typedef std::list<int, STLAllocatorWrapper<int>> IntList;
+
+void FillVector( IntVector& arg_vector )
+{
+	for( int i = 0; i < 200000; i++ )
+	{
+		arg_vector.push_back( i );
+	}
+}
+
+void FillList( IntList& arg_list )
+{
+	for( int i = 0; i < 50000; i++ )
+	{
+		arg_list.push_back( i );
+	}
+}
+
+int main( int arg_n, char** arg_s )
+{
+	FreeListAllocator pool = FreeListAllocator( MIBI( 16 ) );
+	// on average one sample every 16 KiBi.
+	HeapProfiler profiler( &pool, KIBI( 16 ) );
+
+	STLAllocatorWrapper<int> wrapper( &profiler );
+	IntVector numbers( wrapper );
+	IntList queue( wrapper );
+	FillVector( numbers );
+	FillList( queue );
+
+	printf( "%zu live samples, about %zu bytes in use\n", profiler.LiveSampleCount(), profiler.EstimatedLiveBytes() );
+	static char folded_stacks[KIBI( 64 )];
+	profiler.WriteFoldedStacks( folded_stacks, sizeof( folded_stacks ) );
+	printf( "%s\n", folded_stacks );
+
+	// freed allocations are removed from the profile.
+	queue.clear();
+	printf( "after clearing the list: %zu live samples, about %zu bytes in use\n", profiler.LiveSampleCount(), profiler.EstimatedLiveBytes() );
+
+	std::getchar();
+	return 0;
+}
@@ -0,0 +1,85 @@
+// define HSA implemntation
+#define HSA_IMPLEMENTATION
+// include hsa.h
+#include <hsa.h>
+
+#include <cstdio>
+
+/*
+This example shows how to inspect the pool of an allocator.
+Walk() visits every block of a pool. HeapWalkReport turns those blocks into a size histogram and a fragmentation map.
+use this to find out if a pool is out of memory or only fragmented.
+*/
+
+// a callback prints every block. captureless lambdas can also be used as callback.
+void PrintBlock( const HeapBlock& arg_block, void* arg_user_data )
+{
+	HSA_UNUSED( arg_user_data );
+	printf( "%10zu %10zu %8zu %s\n", arg_block.offset_, arg_block.size_, arg_block.padding_, arg_block.is_free_ ? "free" : "used" );
+}
+
+void PrintReport( const char* arg_name, const HeapWalkReport& arg_report )
+{
+	char map[HeapWalkReport::max_map_cells + 1];
+	arg_report.WriteFragmentationMap( map, sizeof( map ) );
+
+	printf( "%s\n", arg_name );
+	printf( "  used: %zu bytes in %zu blocks, %zu bytes overhead\n", arg_report.live_bytes_, arg_report.live_block_count_, arg_report.overhead_bytes_ );
+	printf( "  free: %zu bytes in %zu blocks, largest free block %zu bytes\n", arg_report.free_bytes_, arg_report.free_block_count_, arg_report.largest_free_block_ );
+	printf( "  fragmentation: %.2f\n", arg_report.Fragmentation() );
+	printf( "  size histogram (bytes: used / free)\n" );
+	for( size_t i = 0; i < HeapWalkReport::histogram_bucket_count; i++ )
+	{
+		if( arg_report.live_histogram_[i] != 0 || arg_report.free_histogram_[i] != 0 )
+		{
+			printf( "  %10zu: %6zu / %6zu\n", size_t( 1 ) << i, arg_report.live_histogram_[i], arg_report.free_histogram_[i] );
+		}
+	}
+	printf( "  [%s]\n", map );
+}
+
+int main( int arg_n, char** arg_s )
+{
+	// fragment a free list allocator by freeing every other allocation.
+	FreeListAllocator free_list_alloc = FreeListAllocator( KIBI( 64 ) );
+	void* ptrs[128];
+	for( size_t i = 0; i < 128; i++ )
+	{
+		ptrs[i] = free_list_alloc.Allocate( 64 + ( i % 7 ) * 32, i % 4 == 0 ? 64 : 0 );
+	}
+	for( size_t i = 0; i < 128; i += 2 )
+	{
+		free_list_alloc.Free( ptrs[i] );
+	}
+
+	printf( "    offset       size  padding\n" );
+	free_list_alloc.Walk( PrintBlock );
+
+	HeapWalkReport free_list_report = HeapWalkReport( KIBI( 64 ), 64 );
+	free_list_alloc.Walk( HeapWalkReport::Collect, &free_list_report );
+	PrintReport( "FreeListAllocator", free_list_report );
+
+	// the same report works for the stack and bitmap allocator.
+	BitmapAllocator<64> bitmap_alloc = BitmapAllocator<64>( 1024 );
+	for( size_t i = 0; i < 700; i++ )
+	{
+		void* ptr = bitmap_alloc.Allocate();
+		if( i % 3 == 0 )
+		{
+			bitmap_alloc.Free( ptr );
+		}
+	}
+	HeapWalkReport bitmap_report = HeapWalkReport( 1024 * 64, 64 );
+	bitmap_alloc.Walk( HeapWalkReport::Collect, &bitmap_report );
+	PrintReport( "BitmapAllocator<64>", bitmap_report );
+
+	// an empty pool has no blocks to visit.
+	BitmapAllocator<64> empty_alloc = BitmapAllocator<64>( 0 );
+	size_t empty_block_count = 0;
+	empty_alloc.Walk( []( const HeapBlock&, void* arg_count ) { ++*static_cast< size_t* >( arg_count ); }, &empty_block_count );
+	HSA_ASSERT( empty_block_count == 0 );
+	printf( "empty BitmapAllocator<64>: %zu blocks\n", empty_block_count );
+
+	std::getchar();
+	return 0;
+}
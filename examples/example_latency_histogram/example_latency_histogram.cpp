@@ -0,0 +1,65 @@
+// define HSA implemntation
+#define HSA_IMPLEMENTATION
+// include hsa.h
+#include <hsa.h>
+
+#include <cstdio>
+
+/*
+This example measures the latency of every allocation and free of a free list and a bitmap allocator.
+LatencyTrackingAllocator records the latencies in a histogram per thread. the histograms are merged when they are read.
+the percentiles can be compared against a latency budget, like a p99.9 of 2 microseconds.
+*/
+
+const size_t allocation_count = 4096;
+const uint64_t p999_budget = 2000; // nanoseconds
+
+void PrintHistogram( const char* arg_name, const LatencyHistogram& arg_histogram )
+{
+	char text[8192];
+	arg_histogram.Write( text, sizeof( text ) );
+	printf( "%s\n%s\n", arg_name, text );
+}
+
+int main( int arg_n, char** arg_s )
+{
+	LatencyTrackingAllocator<FreeListAllocator> free_list_alloc( MIBI( 4 ) );
+	LatencyTrackingAllocator<BitmapAllocator<64>> bitmap_alloc( allocation_count );
+	void* ptrs[allocation_count];
+	void* chunks[allocation_count];
+
+	for( size_t round = 0; round < 64; round++ )
+	{
+		for( size_t i = 0; i < allocation_count; i++ )
+		{
+			ptrs[i] = free_list_alloc.Allocate( 16 + ( i * 7919 ) % 512 );
+			chunks[i] = bitmap_alloc.Allocate();
+		}
+		// free every other block first, the free list gets long before the rest is freed.
+		for( size_t i = 0; i < allocation_count; i += 2 )
+		{
+			free_list_alloc.Free( ptrs[i] );
+			bitmap_alloc.Free( chunks[i] );
+		}
+		for( size_t i = 1; i < allocation_count; i += 2 )
+		{
+			free_list_alloc.Free( ptrs[i] );
+			bitmap_alloc.Free( chunks[i] );
+		}
+	}
+
+	LatencyHistogram free_list_allocate = free_list_alloc.AllocateLatency();
+	PrintHistogram( "FreeListAllocator Allocate (ns)", free_list_allocate );
+	PrintHistogram( "FreeListAllocator Free (ns)", free_list_alloc.FreeLatency() );
+	PrintHistogram( "BitmapAllocator<64> Allocate (ns)", bitmap_alloc.AllocateLatency() );
+
+	// histograms can be merged, for example to check one budget for all pools.
+	LatencyHistogram all_allocations = free_list_allocate;
+	all_allocations.Merge( bitmap_alloc.AllocateLatency() );
+	uint64_t p999 = all_allocations.ValueAtPercentile( 99.9 );
+	printf( "p99.9 of all allocations: %llu ns, budget %llu ns: %s\n", static_cast< unsigned long long >( p999 ),
+		static_cast< unsigned long long >( p999_budget ), p999 <= p999_budget ? "ok" : "over budget" );
+
+	std::getchar();
+	return 0;
+}
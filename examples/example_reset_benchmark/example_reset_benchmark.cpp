@@ -0,0 +1,82 @@
+// define HSA implemntation
+#define HSA_IMPLEMENTATION
+// include hsa.h
+#include <hsa.h>
+
+#include <chrono>
+#include <cstdio>
+
+/*
+This example measures Reset() of the bitmap and free list allocator for pools of 1K, 1M and 100M chunks.
+every frame allocates a few objects, frees some of them and resets the allocator.
+the time of Reset() stays the same for every pool size. the 100M pools reserve about 1.6 GiBi of address space.
+*/
+
+using Clock = std::chrono::high_resolution_clock;
+
+const size_t chunk_size = 16;
+const size_t frame_count = 1000;
+
+double BenchmarkBitmap( size_t arg_chunk_count, size_t arg_allocations_per_frame )
+{
+	BitmapAllocator<chunk_size> bitmap_alloc = BitmapAllocator<chunk_size>( arg_chunk_count );
+	void* ptrs[1000];
+	Clock::duration reset_time = Clock::duration::zero();
+	for( size_t frame = 0; frame < frame_count; frame++ )
+	{
+		for( size_t i = 0; i < arg_allocations_per_frame; i++ )
+		{
+			ptrs[i] = bitmap_alloc.Allocate();
+		}
+		for( size_t i = 0; i < arg_allocations_per_frame; i += 2 )
+		{
+			bitmap_alloc.Free( ptrs[i] );
+		}
+
+		Clock::time_point start = Clock::now();
+		bitmap_alloc.Reset();
+		reset_time += Clock::now() - start;
+	}
+	return std::chrono::duration<double, std::nano>( reset_time ).count() / frame_count;
+}
+
+double BenchmarkFreeList( size_t arg_chunk_count, size_t arg_allocations_per_frame )
+{
+	FreeListAllocator free_list_alloc = FreeListAllocator( arg_chunk_count * chunk_size );
+	void* ptrs[1000];
+	Clock::duration reset_time = Clock::duration::zero();
+	for( size_t frame = 0; frame < frame_count; frame++ )
+	{
+		for( size_t i = 0; i < arg_allocations_per_frame; i++ )
+		{
+			ptrs[i] = free_list_alloc.Allocate( chunk_size );
+		}
+		for( size_t i = 0; i < arg_allocations_per_frame; i += 2 )
+		{
+			free_list_alloc.Free( ptrs[i] ); // leaves a free list node for every other block.
+		}
+
+		Clock::time_point start = Clock::now();
+		free_list_alloc.Reset();
+		reset_time += Clock::now() - start;
+	}
+	return std::chrono::duration<double, std::nano>( reset_time ).count() / frame_count;
+}
+
+int main( int arg_n, char** arg_s )
+{
+	const size_t chunk_counts[] = { KIBI( 1 ), MIBI( 1 ), 100 * 1000 * 1000 };
+
+	printf( "%12s %20s %20s\n", "chunks", "bitmap reset (ns)", "free list reset (ns)" );
+	for( size_t chunk_count : chunk_counts )
+	{
+		// every allocation of the free list allocator also needs room for its header.
+		size_t allocations_per_frame = chunk_count / 4 < 1000 ? chunk_count / 4 : 1000;
+		double bitmap_time = BenchmarkBitmap( chunk_count, allocations_per_frame );
+		double free_list_time = BenchmarkFreeList( chunk_count, allocations_per_frame );
+		printf( "%12zu %20.1f %20.1f\n", chunk_count, bitmap_time, free_list_time );
+	}
+
+	std::getchar();
+	return 0;
+}
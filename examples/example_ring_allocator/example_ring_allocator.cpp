@@ -0,0 +1,94 @@
+// define HSA implemntation
+#define HSA_IMPLEMENTATION
+// include hsa.h
+#include <hsa.h>
+
+#include <cstdio>
+#include <thread>
+
+/*
+This example passes messages from a producer thread to a consumer thread through a ring allocator.
+the producer allocates and fills a message, the consumer reads and frees it. messages are freed in the order they are allocated.
+it also checks the edge cases of the ring: a ring that is filled exactly to the end of the pool and drained is empty again.
+*/
+
+const size_t message_count = 1000 * 1000;
+
+struct Message
+{
+	size_t index_;
+	size_t size_;
+};
+
+void CheckEdgeCases()
+{
+	// 4 blocks of 8 byte header + 56 byte payload fill the 256 byte ring exactly to the end.
+	RingAllocator ring_alloc( 256 );
+	void* blocks[4];
+	for( size_t round = 0; round < 3; round++ )
+	{
+		for( size_t i = 0; i < 4; i++ )
+		{
+			blocks[i] = ring_alloc.TryAllocate( 56 );
+			HSA_ASSERT( blocks[i] != nullptr );
+		}
+		HSA_ASSERT( ring_alloc.TryAllocate( 8 ) == nullptr ); // full
+		for( size_t i = 0; i < 4; i++ )
+		{
+			ring_alloc.Free( blocks[i] );
+		}
+		HSA_ASSERT( ring_alloc.UsedSize() == 0 );
+	}
+	// a drained ring can be filled again from where the head stopped.
+	void* block = ring_alloc.TryAllocate( 8 );
+	HSA_ASSERT( block != nullptr );
+	ring_alloc.Free( block );
+	HSA_ASSERT( ring_alloc.UsedSize() == 0 );
+	printf( "edge cases ok\n" );
+}
+
+int main( int arg_n, char** arg_s )
+{
+	CheckEdgeCases();
+
+	RingAllocator ring_alloc( KIBI( 64 ) );
+	std::atomic<Message*> mailbox[256] = {};
+	size_t checksum = 0;
+
+	std::thread consumer( [&]
+	{
+		for( size_t i = 0; i < message_count; i++ )
+		{
+			std::atomic<Message*>& slot = mailbox[i % 256];
+			Message* message;
+			while( ( message = slot.exchange( nullptr, std::memory_order_acquire ) ) == nullptr )
+			{
+				std::this_thread::yield();
+			}
+			checksum += message->index_ + message->size_;
+			ring_alloc.Free( message );
+		}
+	} );
+	for( size_t i = 0; i < message_count; i++ )
+	{
+		// messages have different sizes, so the ring wraps at different offsets.
+		size_t size = sizeof( Message ) + ( i * 7919 ) % 200;
+		while( mailbox[i % 256].load( std::memory_order_acquire ) != nullptr )
+		{
+			std::this_thread::yield();
+		}
+		Message* message;
+		while( ( message = static_cast< Message* >( ring_alloc.TryAllocate( size ) ) ) == nullptr )
+		{
+			std::this_thread::yield(); // the ring is full until the consumer frees the oldest messages.
+		}
+		message->index_ = i;
+		message->size_ = size;
+		mailbox[i % 256].store( message, std::memory_order_release );
+	}
+	consumer.join();
+	printf( "%zu messages, checksum %zu, used %zu bytes\n", message_count, checksum, ring_alloc.UsedSize() );
+
+	std::getchar();
+	return 0;
+}
@@ -24,6 +24,18 @@
 #endif
 #endif
 
+// Check posix. used for memory mapping and shared memory.
+#if __unix__ || __APPLE__
+#define HSA_POSIX
+#endif
+
+// Check c++17 polymorphic memory resources
+#if __cplusplus >= 201703L || _MSVC_LANG >= 201703L
+#if __has_include( <memory_resource> )
+#define HSA_PMR
+#endif
+#endif
+
 #if _DEBUG // only used for personal testing. not platform independent
 #define HSA_DEBUG
 #endif
@@ -48,6 +60,11 @@
 #pragma endregion
 
 #define HSA_UNUSED(arg) (void)(arg)
+#if _MSC_VER
+#define HSA_NOINLINE __declspec( noinline )
+#else
+#define HSA_NOINLINE __attribute__( ( noinline ) )
+#endif
 
 #ifdef HSA_DONT_ASSERT
 #define HSA_ASSERT(arg)
@@ -63,6 +80,20 @@
 
 
 #include <new>
+#include <cstdint>
+#include <type_traits>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <utility>
+#include <functional>
+#if !defined( HSA_NO_SIMD ) && ( __SSE2__ || _M_X64 || _M_IX86_FP >= 2 )
+#define HSA_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef HSA_PMR
+#include <memory_resource>
+#endif // HSA_PMR
 
 /**
 * @brief Abstract class for allocator implementations
@@ -75,10 +106,45 @@ public:
 	*/
 	inline virtual void* Allocate( size_t arg_size, size_t arg_alignment = 0 ) = 0;
 	/**
+	* @brief allocate function that returns nullptr instead of asserting when out of memory.
+	* @details defaults to Allocate(). allocators with a fixed pool override this.
+	*/
+	inline virtual void* TryAllocate( size_t arg_size, size_t arg_alignment = 0 )
+	{
+		return Allocate( arg_size, arg_alignment );
+	}
+	/**
 	* @brief pure virtual free fucntion
 	* @param void* to memory location
 	*/
 	inline virtual void Free( void* arg_ptr ) = 0;
+	/**
+	* @brief tries to grow an allocation without moving it.
+	* @details defaults to false. allocators that can grow the last allocation in place override this.
+	* @param pointer returned by Allocate()
+	* @param current size of the allocation
+	* @param new size of the allocation
+	* @return true if the allocation now has the new size.
+	*/
+	inline virtual bool TryExpand( void* arg_ptr, size_t arg_size, size_t arg_new_size )
+	{
+		HSA_UNUSED( arg_ptr );
+		HSA_UNUSED( arg_size );
+		HSA_UNUSED( arg_new_size );
+		return false;
+	}
+	/**
+	* @brief frees memory of which the size is known.
+	* @details defaults to Free(). allocators that cannot free, like the linear allocator, take the memory back only if it is
+	* the last allocation and ignore it otherwise.
+	* @param pointer returned by Allocate()
+	* @param size of the allocation
+	*/
+	inline virtual void FreeSized( void* arg_ptr, size_t arg_size )
+	{
+		HSA_UNUSED( arg_size );
+		Free( arg_ptr );
+	}
 };
 
 #ifndef HSA_NO_MALLOC
@@ -99,8 +165,9 @@ public:
 #ifndef HSA_NO_MALLOC
 /**
 * @brief Default Aligned malloc Allocator
+* @details uses _aligned_malloc on windows and posix_memalign on other platforms. alignment 0 uses 16 bytes.
 */
-class AlignedMallocAllocator : Allocator
+class AlignedMallocAllocator : public Allocator
 {
 public:
 	AlignedMallocAllocator() = default;
@@ -112,6 +179,19 @@ public:
 };
 #endif // !HSA_NO_MALLOC
 
+namespace detail
+{
+	/**
+	* @brief size and alignment of the value type of an STL wrapper. void counts as one byte, wrappers of void are only rebound.
+	*/
+	template<class C>
+	struct STLValue
+	{
+		typedef typename std::conditional<std::is_void<C>::value, char, C>::type type;
+		static constexpr size_t size = sizeof( type );
+		static constexpr size_t alignment = alignof( type );
+	};
+}
 /**
 * @brief STL compatible wrapper usable for std containers and smart pointers
 */
@@ -148,13 +228,13 @@ public:
 	}
 	/**
 	* @brief move constructor
-	* @detail move constructor that accepts any version of STLAllocatorWrapper
+	* @detail move constructor that accepts any version of STLAllocatorWrapper.
+	* the Allocator* is copied. containers deallocate with a moved from allocator, so it has to stay valid.
 	*/
 	template<class U>
 	STLAllocatorWrapper( STLAllocatorWrapper<U>&& arg_rhs ) : 
 		allocator_(arg_rhs.allocator_)
 	{
-		arg_rhs.allocator_ = nullptr;
 	}
 	/**
 	* @brief destructor
@@ -163,21 +243,31 @@ public:
 	{
 	}
 	/**
-	* @brief allocates x times the sizeof ( C )
+	* @brief allocates x times the sizeof ( C ) aligned to alignof( C )
 	* @param amount objects
+	* @throws bad_array_new_length if the size overflows, bad_alloc if the allocator is out of memory. containers never get nullptr.
 	*/
 	C* allocate( size_t arg_count )
 	{
-		return reinterpret_cast< C* >( allocator_->Allocate( arg_count * sizeof( C ) ) );
+		if( arg_count > SIZE_MAX / detail::STLValue<C>::size )
+		{
+			throw std::bad_array_new_length();
+		}
+		void* ret_ptr = allocator_->TryAllocate( arg_count * detail::STLValue<C>::size, detail::STLValue<C>::alignment );
+		if( ret_ptr == nullptr )
+		{
+			throw std::bad_alloc();
+		}
+		return static_cast< C* >( ret_ptr );
 	}
 	/**
-	* @brief deallocates pointer
+	* @brief deallocates pointer with FreeSized(), so containers also work on a linear allocator.
 	* @param pointer
-	* @param size of allocation UNUSED
+	* @param amount objects
 	*/
 	void deallocate( C* arg_ptr, size_t arg_size )
 	{
-		allocator_->Free( arg_ptr );
+		allocator_->FreeSized( arg_ptr, arg_size * detail::STLValue<C>::size );
 	}
 
 private:
@@ -203,6 +293,116 @@ bool operator!=( const STLAllocatorWrapper<C>& arg_lhs, const STLAllocatorWrappe
 	return arg_lhs.allocator_ != arg_rhs.allocator_;
 }
 
+/**
+* @brief STL compatible wrapper without state, bound to a static allocator.
+* @details the allocator is returned by the function GetAllocator. containers do not store an Allocator*
+* and all instances are equal, so moving and swapping containers never compares or copies allocators.
+* use a function local static to create the allocator on first use.
+* @code
+* Allocator* GetGameAllocator()
+* {
+*	static FreeListAllocator allocator = FreeListAllocator( MIBI( 16 ) );
+*	return &allocator;
+* }
+* std::vector<int, StatelessSTLAllocatorWrapper<int, GetGameAllocator>> vector;
+* @endcode
+*/
+template<class C, Allocator* ( *GetAllocator )( )>
+class StatelessSTLAllocatorWrapper
+{
+public:
+	typedef C value_type;
+	typedef std::true_type is_always_equal;
+	typedef std::true_type propagate_on_container_move_assignment;
+
+	/**
+	* @brief rebind to another type. required because GetAllocator is not a type parameter.
+	*/
+	template<class U>
+	struct rebind
+	{
+		typedef StatelessSTLAllocatorWrapper<U, GetAllocator> other;
+	};
+
+	/**
+	* @brief default constructor
+	*/
+	StatelessSTLAllocatorWrapper() = default;
+	/**
+	* @brief Copy constructor
+	* @detail copy constructor that accepts any version of StatelessSTLAllocatorWrapper with the same GetAllocator
+	*/
+	template<class U>
+	StatelessSTLAllocatorWrapper( const StatelessSTLAllocatorWrapper<U, GetAllocator>& arg_rhs )
+	{
+		HSA_UNUSED( arg_rhs );
+	}
+	/**
+	* @brief allocates x times the sizeof ( C ) aligned to alignof( C )
+	* @param amount objects
+	* @throws bad_array_new_length if the size overflows, bad_alloc if the allocator is out of memory. containers never get nullptr.
+	*/
+	C* allocate( size_t arg_count )
+	{
+		if( arg_count > SIZE_MAX / detail::STLValue<C>::size )
+		{
+			throw std::bad_array_new_length();
+		}
+		void* ret_ptr = GetAllocator()->TryAllocate( arg_count * detail::STLValue<C>::size, detail::STLValue<C>::alignment );
+		if( ret_ptr == nullptr )
+		{
+			throw std::bad_alloc();
+		}
+		return static_cast< C* >( ret_ptr );
+	}
+	/**
+	* @brief deallocates pointer with FreeSized()
+	* @param pointer
+	* @param amount objects
+	*/
+	void deallocate( C* arg_ptr, size_t arg_size )
+	{
+		GetAllocator()->FreeSized( arg_ptr, arg_size * detail::STLValue<C>::size );
+	}
+};
+/**
+* @brief equal operator. always equal because there is no state
+*/
+template<class C, class U, Allocator* ( *GetAllocator )( )>
+bool operator==( const StatelessSTLAllocatorWrapper<C, GetAllocator>&, const StatelessSTLAllocatorWrapper<U, GetAllocator>& )
+{
+	return true;
+}
+/**
+* @brief not equal operator. never not equal because there is no state
+*/
+template<class C, class U, Allocator* ( *GetAllocator )( )>
+bool operator!=( const StatelessSTLAllocatorWrapper<C, GetAllocator>&, const StatelessSTLAllocatorWrapper<U, GetAllocator>& )
+{
+	return false;
+}
+
+/**
+* @brief Description of one block of an allocator pool. Passed to a HeapWalkCallback.
+* @details size_ is the total amount of bytes the block occupies in the pool.
+* the payload of a block is size_ - padding_ - header_size_.
+*/
+struct HeapBlock
+{
+	size_t offset_;			// offset of the first byte of the block from the start of the pool.
+	size_t size_;			// total size of the block in bytes. includes padding and header.
+	size_t padding_;		// bytes lost to alignment in front of the header.
+	size_t header_size_;	// bytes used by the allocator header.
+	bool is_free_;			// true if the block is not in use.
+};
+/**
+* @brief callback used to walk the blocks of an allocator.
+* @param block that is visited
+* @param user data passed to Walk()
+* @attention the callback is not allowed to allocate or free memory with the allocator that is being walked.
+*/
+typedef void( *HeapWalkCallback )( const HeapBlock& arg_block, void* arg_user_data );
+
 /**
 * @brief Linear Allocator for quick allocation.
 * @details Linear Allocator for quick allocation. Dealocation not possible. Allocator can be reset and reused.
@@ -221,6 +421,12 @@ public:
 	*/
 	LinearAllocator( size_t arg_size, Allocator* arg_allocator = nullptr );
 	/**
+	* @brief Constuctor, uses an existing buffer as pool. the buffer is not freed by this allocator.
+	* @param buffer
+	* @param size of the buffer
+	*/
+	LinearAllocator( void* arg_buffer, size_t arg_size );
+	/**
 	* @brief Destructor
 	*/
 	~LinearAllocator();
@@ -233,12 +439,28 @@ public:
 	*/
 	inline virtual void* Allocate( size_t arg_size, size_t alignment = 0 ) override;
 	/**
+	* @brief same as Allocate() but returns nullptr when out of memory.
+	*/
+	inline virtual void* TryAllocate( size_t arg_size, size_t alignment = 0 ) override;
+	/**
+	* @brief checks if memory is part of the pool of this allocator.
+	*/
+	inline virtual bool Owns( const void* arg_ptr ) const;
+	/**
 	* @brief Cannot free memory from linear allocator. function provided for compatibility reasons.
 	* @param void*
 	* @note empty function.
 	*/
 	inline virtual void Free( void* arg_ptr ) override;
 	/**
+	* @brief grows the allocation if it is the last allocation and the pool has room for it.
+	*/
+	inline virtual bool TryExpand( void* arg_ptr, size_t arg_size, size_t arg_new_size ) override;
+	/**
+	* @brief moves the internal ptr back if the memory is the last allocation. does nothing otherwise.
+	*/
+	inline virtual void FreeSized( void* arg_ptr, size_t arg_size ) override;
+	/**
 	* @brief resets the linear allocator and starts from the beginning again.
 	* @attention Previous memory allocations might still be valid. use with care.
 	*/
@@ -248,14 +470,122 @@ protected:
 	char* mem_pool_ = nullptr;
 	size_t pool_size_ = 0;
 	size_t current_offset_ = 0;
+	bool owns_pool_ = true; // false if the pool is a buffer that was passed in.
+	bool page_mapped_ = true; // false if the pool is not registered in the PageMap.
+};
+
+namespace detail
+{
+	/**
+	* @brief header at the start of every chunk of a RegionAllocator.
+	*/
+	struct alignas( 16 ) RegionChunk
+	{
+		RegionChunk* next_;
+		size_t size_;		// size of the chunk including this header.
+	};
+}
+/**
+* @brief Linear Allocator for nested lifetimes. a region allocates from chunks and child regions take their chunks from their parent.
+* @details allocation moves a pointer forward in the newest chunk, like the Linear Allocator. when the chunk is full the region takes
+* a chunk from its own chunk cache, from the cache of its parent or, at the root, from the allocator passed to the constructor.
+* destroying a child region gives all its chunks back to the chunk cache of its parent in O(1) by splicing the chunk lists.
+* destroying the root region frees every chunk. child regions have to be destroyed before their parent.
+* allocations that do not fit in a chunk get a chunk of their own, which also goes to the chunk cache afterwards.
+* @code
+* RegionAllocator request_region( KIBI( 64 ) );
+* {
+*	RegionAllocator query_region( request_region );
+*	{
+*		RegionAllocator batch_region( query_region );
+*		void* rows = batch_region.Allocate( 4096 );
+*	} // the chunks of batch_region go to the cache of query_region
+* }
+* @endcode
+*/
+class RegionAllocator : public LinearAllocator
+{
+public:
+	/**
+	* @brief Constructor of a root region. allocates the first chunk.
+	* @param size of a chunk in bytes. Default = 64 KiBi
+	* @param allocator to be used for the chunks. if nullptr will use malloc. Default = nullptr
+	*/
+	explicit RegionAllocator( size_t arg_chunk_size = KIBI( 64 ), Allocator* arg_allocator = nullptr );
+	/**
+	* @brief Constructor of a child region. takes its first chunk from the parent.
+	* @param parent region. has to outlive this region.
+	*/
+	explicit RegionAllocator( RegionAllocator& arg_parent );
+	RegionAllocator( const RegionAllocator& ) = delete;
+	RegionAllocator& operator=( const RegionAllocator& ) = delete;
+	/**
+	* @brief Destructor. a child region gives its chunks to the parent, the root region frees them.
+	*/
+	~RegionAllocator();
+	/**
+	* @brief allocates from the newest chunk. takes a new chunk if it is full.
+	*/
+	inline virtual void* Allocate( size_t arg_size, size_t arg_alignment = 0 ) override;
+	/**
+	* @brief same as Allocate() but returns nullptr when no chunk can be allocated.
+	*/
+	inline virtual void* TryAllocate( size_t arg_size, size_t arg_alignment = 0 ) override;
+	/**
+	* @brief checks if memory is part of a chunk that is used by this region. does not look at child regions.
+	*/
+	inline virtual bool Owns( const void* arg_ptr ) const override;
+	/**
+	* @brief does nothing. memory is released when the region is reset or destroyed.
+	*/
+	inline virtual void Free( void* arg_ptr ) override;
+	/**
+	* @brief releases all allocations of this region. keeps the newest chunk and moves the others to the chunk cache in O(1).
+	* @attention memory of this region may not be used anymore. child regions are not affected.
+	*/
+	inline virtual void Reset() override;
+	/**
+	* @brief the root region frees the chunks in its cache. a child region gives them to its parent.
+	*/
+	void ReleaseCached();
+	inline size_t ChunkSize() const;
+
+private:
+	void* AllocateChunk( size_t arg_size, size_t arg_alignment );
+	detail::RegionChunk* AcquireChunk( size_t arg_min_size );
+	void DestroyChunks( detail::RegionChunk* arg_chunk );
+
+	RegionAllocator* parent_ = nullptr;
+	size_t chunk_size_ = 0;
+	size_t child_count_ = 0;
+	detail::RegionChunk* used_head_ = nullptr;	// newest chunk, used by the LinearAllocator. older chunks follow next_.
+	detail::RegionChunk* used_tail_ = nullptr;
+	detail::RegionChunk* free_head_ = nullptr;	// chunk cache.
+	detail::RegionChunk* free_tail_ = nullptr;
 };
 
 namespace detail
 {
+	/**
+	* @brief 8 byte header in front of every stack allocation.
+	* @details headers start at multiples of 8 bytes from the start of the pool. the previous header is stored as its index
+	* in 8 byte steps, so a stack pool can be up to 32 GiBi. the free flag is packed in the lowest bit of the adjustment.
+	*/
 	struct StackHeader
 	{
-		StackHeader* previous_header_;
-		bool is_free_;
+		static const size_t granularity = 8;
+
+		uint32_t previous_index_;	// offset of the previous header / granularity + 1. 0 if there is no previous header.
+		uint32_t adjustment_flags_;	// alignment padding in front of the header << 1. bit 0 is set if the block is free.
+
+		size_t Adjustment() const
+		{
+			return adjustment_flags_ >> 1;
+		}
+		bool IsFree() const
+		{
+			return ( adjustment_flags_ & 1u ) != 0;
+		}
 	};
 }
 /**
@@ -279,6 +609,12 @@ public:
 	*/
 	StackAllocator( size_t arg_size, Allocator* arg_allocator = nullptr );
 	/**
+	* @brief Constuctor, uses an existing buffer as pool. the buffer is not freed by this allocator.
+	* @param buffer
+	* @param size of the buffer
+	*/
+	StackAllocator( void* arg_buffer, size_t arg_size );
+	/**
 	* @brief Destructor
 	*/
 	~StackAllocator();
@@ -291,6 +627,14 @@ public:
 	*/
 	inline virtual void* Allocate( size_t arg_size, size_t alignment = 0 ) override;
 	/**
+	* @brief same as Allocate() but returns nullptr when out of memory.
+	*/
+	inline virtual void* TryAllocate( size_t arg_size, size_t alignment = 0 ) override;
+	/**
+	* @brief checks if memory is part of the pool of this allocator.
+	*/
+	inline virtual bool Owns( const void* arg_ptr ) const;
+	/**
 	* @brief list elements in the stack allocator as free. if last element in stack is freed it will go back as far as possible.
 	* @param void*
 	*/
@@ -300,6 +644,12 @@ public:
 	* @attention Previous memory allocations might still be valid. use with care.
 	*/
 	inline virtual void Reset();
+	/**
+	* @brief visits every block in the stack in address order. unused memory at the top of the stack is reported as one free block.
+	* @param callback
+	* @param user data passed to the callback. Default = nullptr
+	*/
+	inline virtual void Walk( HeapWalkCallback arg_callback, void* arg_user_data = nullptr );
 protected:
 
 	Allocator * allocator_ = nullptr;
@@ -307,6 +657,76 @@ protected:
 	size_t pool_size_ = 0;
 	size_t current_offset_ = 0;
 	detail::StackHeader* last_allocated_header = nullptr;
+	bool owns_pool_ = true; // false if the pool is a buffer that was passed in.
+
+	inline uint32_t IndexOf( const detail::StackHeader* arg_header ) const;
+	inline detail::StackHeader* PreviousOf( const detail::StackHeader* arg_header ) const;
+};
+
+/**
+* @brief Ring buffer allocator. allocates at the head of the pool and frees from the tail, first in first out.
+* @details every block starts with an 8 byte header that holds its size and a free flag. a block that is freed before the blocks in front
+* of it stays in the ring until the tail reaches it. a block never wraps around the end of the pool, when it does not fit the rest of the pool
+* is skipped and the block is placed at the start.
+* one producer thread can allocate while one consumer thread frees without a lock. the producer only writes the head and the consumer only
+* writes the tail, so there is no extra cost when one thread does both.
+* @code
+* RingAllocator packet_alloc( MIBI( 4 ) );
+* void* packet = packet_alloc.Allocate( 1500 );	// producer thread
+* packet_alloc.Free( packet );					// consumer thread
+* @endcode
+*/
+class RingAllocator : public Allocator
+{
+public:
+	/**
+	* @brief Constructor
+	* @param size of the pool in bytes
+	* @param allocator to be used. if nullptr will use malloc. Default = nullptr
+	*/
+	RingAllocator( size_t arg_size, Allocator* arg_allocator = nullptr );
+	~RingAllocator();
+	RingAllocator( const RingAllocator& ) = delete;
+	RingAllocator& operator=( const RingAllocator& ) = delete;
+	/**
+	* @brief allocates at the head of the ring. only called by the producer thread.
+	* @param size
+	* @param alignment, at least 8. Default = 0
+	*/
+	inline virtual void* Allocate( size_t arg_size, size_t arg_alignment = 0 ) override;
+	/**
+	* @brief same as Allocate() but returns nullptr when the ring is full.
+	*/
+	inline virtual void* TryAllocate( size_t arg_size, size_t arg_alignment = 0 ) override;
+	/**
+	* @brief marks a block as free and moves the tail over all free blocks. only called by the consumer thread.
+	*/
+	inline virtual void Free( void* arg_ptr ) override;
+	/**
+	* @brief checks if memory is part of the pool of this allocator.
+	*/
+	inline virtual bool Owns( const void* arg_ptr ) const;
+	/**
+	* @brief frees all blocks.
+	* @attention no other thread may use the allocator during the reset.
+	*/
+	inline virtual void Reset();
+	/**
+	* @brief amount of bytes between the tail and the head, including headers, padding and freed blocks the tail did not reach yet.
+	*/
+	inline size_t UsedSize() const;
+
+private:
+	Allocator* allocator_ = nullptr;
+	char* mem_pool_ = nullptr;
+	size_t pool_size_ = 0;
+
+	// written by the producer.
+	alignas( 64 ) size_t head_ = 0;
+	std::atomic<uint64_t> allocated_ = { 0 };	// bytes ever allocated, including skipped space at the end of the pool.
+	// written by the consumer.
+	alignas( 64 ) std::atomic<size_t> tail_ = { 0 };
+	std::atomic<uint64_t> released_ = { 0 };	// bytes ever released by moving the tail.
 };
 
 namespace detail
@@ -318,6 +738,45 @@ namespace detail
 	};
 }
 /**
+* @brief 32 bit handle to a chunk of a bitmap allocator. packs the chunk index and a generation counter.
+* @details a handle becomes stale when its chunk is freed. resolving a stale handle returns nullptr.
+* the generation wraps after 1023 allocations of the same chunk. the default handle is never valid.
+*/
+struct PoolHandle
+{
+	static const uint32_t index_bits = 22;
+	static const uint32_t generation_bits = 32 - index_bits;
+	static const uint32_t max_index = ( 1u << index_bits ) - 1;
+	static const uint32_t max_generation = ( 1u << generation_bits ) - 1;
+
+	PoolHandle( uint32_t arg_value = 0 ) :
+		value_( arg_value )
+	{
+	}
+	PoolHandle( size_t arg_index, uint32_t arg_generation ) :
+		value_( static_cast< uint32_t >( arg_index ) | ( arg_generation << index_bits ) )
+	{
+	}
+	size_t Index() const
+	{
+		return value_ & max_index;
+	}
+	uint32_t Generation() const
+	{
+		return value_ >> index_bits;
+	}
+	bool operator==( const PoolHandle& arg_rhs ) const
+	{
+		return value_ == arg_rhs.value_;
+	}
+	bool operator!=( const PoolHandle& arg_rhs ) const
+	{
+		return value_ != arg_rhs.value_;
+	}
+
+	uint32_t value_; // generation 0 is never used so 0 is an invalid handle.
+};
+/**
 * @brief Bitmap Allocator for quick same size allocation.
 * @details Bitmap Allocator for quick same size allocation. Dealocation Possible.
 * Allocator can be reset and reused.
@@ -337,6 +796,13 @@ public:
 	*/
 	BitmapAllocator( size_t arg_chunk_count, Allocator* arg_allocator = nullptr );
 	/**
+	* @brief Constuctor, uses existing buffers for the chunks and the bitmap. the buffers are not freed by this allocator.
+	* @param buffer for chunk count chunks of ChunkSize bytes
+	* @param buffer for the bitmap, one bit for every chunk
+	* @param chunk count, has to be a multiple of 8
+	*/
+	BitmapAllocator( void* arg_chunk_buffer, unsigned char* arg_bitmap_buffer, size_t arg_chunk_count );
+	/**
 	* @brief Destructor
 	*/
 	~BitmapAllocator();
@@ -345,49 +811,352 @@ public:
 	*/
 	inline void* Allocate();
 	/**
+	* @brief same as Allocate() but returns nullptr when all chunks are used.
+	*/
+	inline void* TryAllocate();
+	/**
+	* @brief checks if memory is part of the pool of this allocator.
+	*/
+	inline bool Owns( const void* arg_ptr ) const;
+	/**
 	* @brief Deallocates one chunk
 	* @param chunk pointer
 	*/
 	inline void Free( void* arg_ptr );
 	/**
-	* @brief Resets the bitmap allocator
+	* @brief Resets the bitmap allocator in constant time. the bitmap is cleared lazily by the following allocations.
 	* @attention Previous memory allocations might still be valid. use with care.
 	*/
 	inline void Reset();
+	/**
+	* @brief Allocates one chunk and returns a handle to it instead of a pointer.
+	* @details the first call allocates a generation counter for every chunk. chunk count cannot be larger than PoolHandle::max_index + 1.
+	*/
+	inline PoolHandle AllocateHandle();
+	/**
+	* @brief Deallocates the chunk of a handle. the handle and all copies of it become stale.
+	* @param handle
+	*/
+	inline void Free( PoolHandle arg_handle );
+	/**
+	* @brief returns the chunk of a handle.
+	* @return pointer to the chunk. nullptr if the handle is stale or invalid.
+	*/
+	inline void* Resolve( PoolHandle arg_handle ) const;
+	/**
+	* @brief creates a handle for an allocated chunk.
+	* @param chunk pointer
+	*/
+	inline PoolHandle HandleOf( void* arg_ptr );
+	/**
+	* @brief visits every run of used or free chunks in address order.
+	* @param callback
+	* @param user data passed to the callback. Default = nullptr
+	*/
+	inline void Walk( HeapWalkCallback arg_callback, void* arg_user_data = nullptr ) const;
+	/**
+	* @brief gives pages that only contain free memory back to the operating system. the memory stays usable.
+	* @return amount of bytes that were resident and are released.
+	* @note only releases memory on posix platforms. returns 0 on other platforms.
+	*/
+	inline size_t Trim();
+	/**
+	* @brief calls Trim() automatically when the amount of freed bytes since the last Trim() reaches the threshold.
+	* @param threshold in bytes. 0 disables automatic trimming. Default = 0
+	*/
+	inline void SetTrimThreshold( size_t arg_threshold );
 private:
 	Allocator * allocator_ = nullptr;
 	size_t chunk_size_ = 0;
 	size_t chunk_count_ = 0;
 	detail::bitmapChunk<ChunkSize>* mem_pool_ = nullptr;
 	unsigned char* bitmap_ = nullptr;
+	uint16_t* generations_ = nullptr; // only allocated when handles are used.
 	size_t last_allocate_chunk = -1; // 0 is a valid chunk
+	size_t dirty_bytes_ = 0; // bitmap bytes from this index on are not cleared yet and count as 0.
+	bool owns_pool_ = true; // false if the chunks and bitmap are buffers that were passed in.
+	size_t trim_threshold_ = 0;
+	size_t freed_since_trim_ = 0;
+
+	inline unsigned char BitmapByte( size_t arg_byte_pos ) const;
+	inline void MarkUsed( size_t arg_index );
+	inline void InitGenerations();
+	inline void NextGeneration( size_t arg_index );
 };
-namespace detail
+/**
+* @brief Linear allocator with its pool stored inside the object. does not allocate memory.
+* @details can be used as global or local variable, also when HSA_NO_MALLOC is defined.
+*/
+template<size_t Bytes>
+class StaticLinearAllocator : public LinearAllocator
 {
-	namespace FreeList
-	{ 
-		const size_t minimum_header_size = 8;
+public:
+	static constexpr size_t pool_size = Bytes;
+
+	StaticLinearAllocator() :
+		LinearAllocator( storage_, Bytes )
+	{
 	}
-	struct FreeListHeader
+	StaticLinearAllocator( const StaticLinearAllocator& ) = delete;
+	StaticLinearAllocator& operator=( const StaticLinearAllocator& ) = delete;
+
+private:
+	alignas( 16 ) char storage_[Bytes];
+};
+/**
+* @brief Stack allocator with its pool stored inside the object. does not allocate memory.
+* @details can be used as global or local variable, also when HSA_NO_MALLOC is defined.
+*/
+template<size_t Bytes>
+class StaticStackAllocator : public StackAllocator
+{
+public:
+	static constexpr size_t pool_size = Bytes;
+
+	StaticStackAllocator() :
+		StackAllocator( storage_, Bytes )
 	{
-		FreeListHeader(void* arg_ptr = nullptr, size_t arg_size = 0) :
-			header_ptr_(arg_ptr),
-			size_(arg_size)
-		{
+	}
+	StaticStackAllocator( const StaticStackAllocator& ) = delete;
+	StaticStackAllocator& operator=( const StaticStackAllocator& ) = delete;
 
-		}
-		bool operator<( FreeListHeader& arg_rhs )
-		{
-			return reinterpret_cast<size_t>(header_ptr_) < reinterpret_cast<size_t>(arg_rhs.header_ptr_);
-		}
-		bool operator==( FreeListHeader& arg_rhs )
-		{
-#ifdef HSA_DEBUG
-			if( header_ptr_ == arg_rhs.header_ptr_ )
-			{
-				if( size_ == arg_rhs.size_ )
-				{
-					return true;
+private:
+	alignas( 16 ) char storage_[Bytes];
+};
+/**
+* @brief Bitmap allocator with its chunks and bitmap stored inside the object. does not allocate memory.
+* @details can be used as global or local variable, also when HSA_NO_MALLOC is defined. Count is rounded up to a multiple of 8.
+* handles still allocate a generation counter for every chunk on first use.
+*/
+template<size_t ChunkSize, size_t Count>
+class StaticBitmapAllocator : public BitmapAllocator<ChunkSize>
+{
+public:
+	static constexpr size_t chunk_count = ( Count + 7 ) / 8 * 8;
+	static constexpr size_t bitmap_size = chunk_count / 8;
+	static constexpr size_t pool_size = chunk_count * ChunkSize;
+
+	StaticBitmapAllocator() :
+		BitmapAllocator<ChunkSize>( chunk_storage_, bitmap_storage_, chunk_count )
+	{
+	}
+	StaticBitmapAllocator( const StaticBitmapAllocator& ) = delete;
+	StaticBitmapAllocator& operator=( const StaticBitmapAllocator& ) = delete;
+
+private:
+	alignas( 16 ) char chunk_storage_[pool_size];
+	unsigned char bitmap_storage_[bitmap_size];
+};
+/**
+* @brief Pool of fixed size chunks. free chunks form a singly linked list that is stored in the chunks themselves.
+* @details Allocate() pops the first free chunk and Free() pushes it back, there is no search. freed chunks are reused first,
+* so recently used memory that is still in the cache is handed out again. chunks that were never used are taken from the end
+* of the used part of the pool, which makes construction and Reset() O(1).
+* chunks are at least sizeof( void* ) bytes and are aligned to the largest power of two that divides the chunk size, up to 16 bytes.
+*/
+class PoolAllocator : public Allocator
+{
+public:
+	/**
+	* @brief Constructor
+	* @param chunk size in bytes, rounded up to a multiple of sizeof( void* )
+	* @param chunk count
+	* @param allocator to be used. if nullptr will use malloc. Default = nullptr
+	*/
+	PoolAllocator( size_t arg_chunk_size, size_t arg_chunk_count, Allocator* arg_allocator = nullptr );
+	/**
+	* @brief Constuctor, uses an existing buffer as pool. the buffer is not freed by this allocator.
+	* @param buffer of at least chunk size * chunk count bytes
+	* @param chunk size in bytes, rounded up to a multiple of sizeof( void* )
+	* @param chunk count
+	*/
+	PoolAllocator( void* arg_buffer, size_t arg_chunk_size, size_t arg_chunk_count );
+	~PoolAllocator();
+	PoolAllocator( const PoolAllocator& ) = delete;
+	PoolAllocator& operator=( const PoolAllocator& ) = delete;
+	/**
+	* @brief takes one chunk from the free list.
+	*/
+	inline void* Allocate();
+	/**
+	* @brief same as Allocate() but returns nullptr when all chunks are used.
+	*/
+	inline void* TryAllocate();
+	/**
+	* @brief allocates one chunk. size and alignment have to fit in a chunk.
+	*/
+	inline virtual void* Allocate( size_t arg_size, size_t arg_alignment = 0 ) override;
+	inline virtual void* TryAllocate( size_t arg_size, size_t arg_alignment = 0 ) override;
+	/**
+	* @brief pushes a chunk on the free list.
+	*/
+	inline virtual void Free( void* arg_ptr ) override;
+	/**
+	* @brief checks if memory is part of the pool of this allocator.
+	*/
+	inline virtual bool Owns( const void* arg_ptr ) const;
+	/**
+	* @brief frees all chunks in constant time.
+	* @attention Previous memory allocations might still be valid. use with care.
+	*/
+	inline virtual void Reset();
+	inline size_t ChunkSize() const;
+	inline size_t ChunkCount() const;
+
+protected:
+	/**
+	* @brief fast path shared with FixedPoolAllocator, which passes its chunk size as a constant.
+	*/
+	inline void* TryAllocateChunk( size_t arg_chunk_size );
+	inline void* TryAllocateChunk( size_t arg_size, size_t arg_alignment, size_t arg_chunk_size );
+	inline void FreeChunk( void* arg_ptr, size_t arg_chunk_size );
+	inline bool OwnsChunk( const void* arg_ptr, size_t arg_chunk_size ) const;
+
+	Allocator* allocator_ = nullptr;
+	char* mem_pool_ = nullptr;
+	size_t chunk_size_ = 0;
+	size_t chunk_count_ = 0;
+	void* free_list_ = nullptr;	// first free chunk. the first word of a free chunk points to the next one.
+	size_t unused_offset_ = 0;	// chunks from this offset on were never allocated since the last Reset().
+	bool owns_pool_ = true;		// false if the pool is a buffer that was passed in.
+};
+/**
+* @brief PoolAllocator with the chunk size as template parameter, like the bitmap allocator.
+* @details allocation, Free() and Owns() use the fast path of the PoolAllocator with the constant chunk size, so the compiler
+* turns the size math into shifts and immediates.
+*/
+template<size_t ChunkBytes>
+class FixedPoolAllocator : public PoolAllocator
+{
+	static_assert( ChunkBytes >= sizeof( void* ), "chunk has to be able to hold the link of the free list" );
+public:
+	static constexpr size_t chunk_size = ( ChunkBytes + sizeof( void* ) - 1 ) / sizeof( void* ) * sizeof( void* );
+
+	/**
+	* @brief Constructor
+	* @param chunk count
+	* @param allocator to be used. if nullptr will use malloc. Default = nullptr
+	*/
+	explicit FixedPoolAllocator( size_t arg_chunk_count, Allocator* arg_allocator = nullptr ) :
+		PoolAllocator( ChunkBytes, arg_chunk_count, arg_allocator )
+	{
+	}
+	FixedPoolAllocator( const FixedPoolAllocator& ) = delete;
+	FixedPoolAllocator& operator=( const FixedPoolAllocator& ) = delete;
+	using PoolAllocator::Allocate;
+	/**
+	* @brief takes one chunk from the free list.
+	*/
+	inline void* Allocate();
+	/**
+	* @brief same as Allocate() but returns nullptr when all chunks are used.
+	*/
+	inline void* TryAllocate();
+	inline virtual void* TryAllocate( size_t arg_size, size_t arg_alignment = 0 ) override;
+	inline virtual void Free( void* arg_ptr ) override;
+	inline virtual bool Owns( const void* arg_ptr ) const override;
+};
+/**
+* @brief Pool of objects of type T. Uses a bitmap to keep track of live objects like the bitmap allocator.
+* @details objects are constructed with Create() and destructed with Destroy(). new objects are placed in the lowest free slot
+* so live objects stay dense. ForEach() visits live objects in address order by scanning 64 bit words of the bitmap.
+* the capacity is rounded up to a multiple of 64.
+*/
+template <class T>
+class TypedPool
+{
+public:
+	/**
+	* @brief Constructor, allocates memory for arg_capacity objects.
+	* @param capacity
+	* @param allocator to be used. if nullptr will use malloc. Default = nullptr
+	*/
+	TypedPool( size_t arg_capacity, Allocator* arg_allocator = nullptr );
+	/**
+	* @brief Destructor, destructs all live objects.
+	*/
+	~TypedPool();
+	TypedPool( const TypedPool& ) = delete;
+	TypedPool& operator=( const TypedPool& ) = delete;
+	/**
+	* @brief constructs an object in the lowest free slot.
+	* @param arguments passed to the constructor of T
+	* @return pointer to the object. nullptr if the pool is full.
+	*/
+	template<class... Args>
+	inline T* Create( Args&&... arg_args );
+	/**
+	* @brief destructs an object and marks its slot as free.
+	* @param pointer returned by Create()
+	*/
+	inline void Destroy( T* arg_ptr );
+	/**
+	* @brief destructs all live objects.
+	*/
+	inline void Clear();
+	/**
+	* @brief calls arg_function( T& ) for every live object in address order.
+	* @attention the function can destroy the object it is called with but should not create objects.
+	*/
+	template<class Function>
+	inline void ForEach( Function&& arg_function );
+	/**
+	* @brief calls arg_function( T& ) for every live object with a slot index in [first, last) in address order.
+	* @details ranges that do not overlap can be visited from different threads at the same time.
+	* ranges that start and end on a multiple of 64 never share a bitmap word.
+	*/
+	template<class Function>
+	inline void ForEach( size_t arg_first, size_t arg_last, Function&& arg_function );
+	/**
+	* @brief slot index of an object. use it to split work for ForEach( first, last, function ).
+	*/
+	inline size_t IndexOf( const T* arg_ptr ) const;
+	/**
+	* @brief amount of slots in the pool.
+	*/
+	inline size_t Capacity() const;
+	/**
+	* @brief amount of live objects.
+	*/
+	inline size_t Size() const;
+
+private:
+	static const size_t bits_per_word = 64;
+
+	Allocator * allocator_ = nullptr;
+	T* objects_ = nullptr;
+	uint64_t* bitmap_ = nullptr;
+	size_t capacity_ = 0;
+	size_t word_count_ = 0;
+	size_t live_count_ = 0;
+	size_t search_word_ = 0; // every word in front of this word is full.
+};
+namespace detail
+{
+	namespace FreeList
+	{ 
+		const size_t minimum_header_size = 8;
+	}
+	struct FreeListHeader
+	{
+		FreeListHeader(void* arg_ptr = nullptr, size_t arg_size = 0) :
+			header_ptr_(arg_ptr),
+			size_(arg_size)
+		{
+
+		}
+		bool operator<( FreeListHeader& arg_rhs )
+		{
+			return reinterpret_cast<size_t>(header_ptr_) < reinterpret_cast<size_t>(arg_rhs.header_ptr_);
+		}
+		bool operator==( FreeListHeader& arg_rhs )
+		{
+#ifdef HSA_DEBUG
+			if( header_ptr_ == arg_rhs.header_ptr_ )
+			{
+				if( size_ == arg_rhs.size_ )
+				{
+					return true;
 				}
 				else
 				{
@@ -415,6 +1184,63 @@ namespace detail
 		size_t size_;
 	};
 	/**
+	* @brief 8 byte header in front of every free list allocation. packs the size, the alignment padding and flags in one word.
+	* @details bit 0 is always set. padding words are multiples of 8, so Walk() can tell them apart from a header.
+	* a padding up to 2040 bytes is stored in 8 byte steps in bits 2 to 9. a bigger padding sets the wide bit
+	* and is stored in the word in front of the header, which makes the header 16 bytes.
+	*/
+	struct CompactAllocationHeader
+	{
+		static const uint64_t tag_bit = 1;
+		static const uint64_t wide_bit = 2;
+		static const size_t granularity = 8;
+		static const size_t max_short_padding = 255 * granularity;
+
+		uint64_t word_;
+
+		size_t Size() const
+		{
+			return static_cast< size_t >( word_ >> 10 );
+		}
+		bool IsWide() const
+		{
+			return ( word_ & wide_bit ) != 0;
+		}
+		size_t HeaderSize() const
+		{
+			return IsWide() ? 2 * sizeof( uint64_t ) : sizeof( uint64_t );
+		}
+		size_t Padding() const
+		{
+			return IsWide() ? static_cast< size_t >( *( &word_ - 1 ) ) : static_cast< size_t >( ( word_ >> 2 ) & 0xFF ) * granularity;
+		}
+		void Set( size_t arg_size, size_t arg_padding, bool arg_is_wide )
+		{
+			if( arg_is_wide )
+			{
+				*( &word_ - 1 ) = arg_padding;
+				word_ = ( static_cast< uint64_t >( arg_size ) << 10 ) | wide_bit | tag_bit;
+			}
+			else
+			{
+				word_ = ( static_cast< uint64_t >( arg_size ) << 10 ) | ( static_cast< uint64_t >( arg_padding / granularity ) << 2 ) | tag_bit;
+			}
+		}
+	};
+	/**
+	* @brief compares values. pointers are compared by the value they point to.
+	*/
+	template<typename DataType>
+	inline bool IsLess( DataType& arg_lhs, DataType& arg_rhs )
+	{
+		return arg_lhs < arg_rhs;
+	}
+	template<typename DataType>
+	inline bool IsLess( DataType* arg_lhs, DataType* arg_rhs )
+	{
+		return *arg_lhs < *arg_rhs;
+	}
+	/**
 	* @brief Ascending ordered single link list
 	*/
 	template<typename DataType >
@@ -508,8 +1334,7 @@ namespace detail
 			}
 			HSA_ASSERT( allocator_ != nullptr );
 			head_ = nullptr;
-			void* mem_block = allocator_->Allocate( sizeof( Node ) );
-			tail_ = new(mem_block) Node();
+			tail_ = &tail_node_;
 
 			size_ = 0;
 		}
@@ -549,15 +1374,15 @@ namespace detail
 		{
 			void* mem_block = allocator_->Allocate( sizeof( Node ) );
 			Node *node = new(mem_block) Node();
-			if( head_ == nullptr )
+			if( head_ == nullptr || IsLess( arg_data, head_->data_ ) )
 			{
-				node->next_ = tail_;
+				node->next_ = head_ == nullptr ? tail_ : head_;
 				head_ = node;
 			}
 			else
 			{
 				Node* previous = head_;
-				while( previous->data_ < arg_data && previous->next_ != tail_ )
+				while( previous->next_ != tail_ && IsLess( previous->next_->data_, arg_data ) )
 				{
 					previous = previous->next_;
 				}
@@ -570,6 +1395,40 @@ namespace detail
 			return Iterator( node );
 		}
 
+		/**
+		* @brief inserts ascending ordered data in one pass over the list.
+		* @param array of data, ordered ascending
+		* @param count
+		*/
+		void InsertSorted( const DataType* arg_data, size_t arg_count )
+		{
+			Node* previous = nullptr;
+			Node* next = head_ == nullptr ? tail_ : head_;
+			for( size_t i = 0; i < arg_count; i++ )
+			{
+				DataType data = arg_data[i];
+				while( next != tail_ && IsLess( next->data_, data ) )
+				{
+					previous = next;
+					next = next->next_;
+				}
+				void* mem_block = allocator_->Allocate( sizeof( Node ) );
+				Node *node = new(mem_block) Node();
+				node->data_ = data;
+				node->next_ = next;
+				if( previous == nullptr )
+				{
+					head_ = node;
+				}
+				else
+				{
+					previous->next_ = node;
+				}
+				previous = node;
+				++size_;
+			}
+		}
+
 		Iterator Find( DataType arg_data )
 		{
 			Node *node = head_;
@@ -605,13 +1464,28 @@ namespace detail
 			}
 		}
 
+		/**
+		* @brief erases the element after the iterator in constant time.
+		*/
+		void EraseAfter( Iterator arg_itr )
+		{
+			Node* node = arg_itr.node_->next_;
+			if( node != tail_ )
+			{
+				arg_itr.node_->next_ = node->next_;
+				node->~Node();
+				allocator_->Free( node );
+				--size_;
+			}
+		}
+
 		void Clear()
 		{
 			Node* node = head_;
 
 			if( node != nullptr )
 			{
-				while( node->next_ != tail_ )
+				while( node != tail_ )
 				{
 					Node* free_node = node;
 					node = node->next_;
@@ -623,14 +1497,110 @@ namespace detail
 			size_ = 0;
 		}
 
+		/**
+		* @brief empties the list without freeing the nodes. use when the allocator releases all nodes at once.
+		*/
+		void Abandon()
+		{
+			head_ = nullptr;
+			size_ = 0;
+		}
+
 	private:
 		Allocator * allocator_;
 		bool has_custom_allocator_;
 
 		Node* head_;
 		Node* tail_;
+		Node tail_node_; // end marker. never holds data.
 		size_t size_;
 	};
+
+	/**
+	* @brief Allocator for same size slots, used for the bookkeeping of the free list allocator.
+	* @details slots are taken from slabs that are allocated with the parent allocator. freed slots are reused first.
+	* Reset() frees all slots at once in constant time. slabs are kept and reused until the pool is destroyed.
+	*/
+	class SlotPool : public Allocator
+	{
+	public:
+		SlotPool( size_t arg_slot_size, size_t arg_slots_per_slab, Allocator* arg_allocator ) :
+			allocator_( arg_allocator ),
+			slot_size_( ( arg_slot_size + sizeof( void* ) - 1 ) / sizeof( void* ) * sizeof( void* ) ),
+			slots_per_slab_( arg_slots_per_slab )
+		{
+			HSA_ASSERT( allocator_ != nullptr && slot_size_ >= sizeof( void* ) );
+		}
+		~SlotPool()
+		{
+			while( first_slab_ != nullptr )
+			{
+				Slab* next = first_slab_->next_;
+				allocator_->Free( first_slab_ );
+				first_slab_ = next;
+			}
+		}
+		inline virtual void* Allocate( size_t arg_size, size_t arg_alignment = 0 ) override
+		{
+			HSA_UNUSED( arg_alignment );
+			HSA_ASSERT( arg_size <= slot_size_ ); // slot too small
+			if( free_slot_ != nullptr )
+			{
+				void* slot = free_slot_;
+				free_slot_ = *reinterpret_cast< void** >( free_slot_ );
+				return slot;
+			}
+			if( current_slab_ == nullptr || used_slots_ == slots_per_slab_ )
+			{
+				Slab* next = current_slab_ != nullptr ? current_slab_->next_ : first_slab_;
+				if( next == nullptr )
+				{
+					next = static_cast< Slab* >( allocator_->Allocate( sizeof( Slab ) + slot_size_ * slots_per_slab_, alignof( Slab ) ) );
+					HSA_ASSERT( next != nullptr ); // out of memory
+					next->next_ = nullptr;
+					if( current_slab_ != nullptr )
+					{
+						current_slab_->next_ = next;
+					}
+					else
+					{
+						first_slab_ = next;
+					}
+				}
+				current_slab_ = next;
+				used_slots_ = 0;
+			}
+			return reinterpret_cast< char* >( current_slab_ + 1 ) + slot_size_ * used_slots_++;
+		}
+		inline virtual void Free( void* arg_ptr ) override
+		{
+			*reinterpret_cast< void** >( arg_ptr ) = free_slot_;
+			free_slot_ = arg_ptr;
+		}
+		/**
+		* @brief frees all slots. constant time.
+		*/
+		inline void Reset()
+		{
+			current_slab_ = nullptr;
+			used_slots_ = 0;
+			free_slot_ = nullptr;
+		}
+
+	private:
+		struct Slab
+		{
+			Slab* next_; // slots follow the slab header.
+		};
+
+		Allocator* allocator_;
+		size_t slot_size_;
+		size_t slots_per_slab_;
+		Slab* first_slab_ = nullptr;
+		Slab* current_slab_ = nullptr;	// slab that slots are taken from. nullptr before the first allocation.
+		size_t used_slots_ = 0;			// slots taken from current_slab_.
+		void* free_slot_ = nullptr;		// singly linked list of freed slots.
+	};
 }
 /**
 * @brief Freelist Allocator for general purpose allocation.
@@ -662,11 +1632,26 @@ public:
 	*/
 	inline virtual void* Allocate( size_t arg_size, size_t alignment = 0 ) override;
 	/**
+	* @brief same as Allocate() but returns nullptr when out of memory.
+	*/
+	inline virtual void* TryAllocate( size_t arg_size, size_t alignment = 0 ) override;
+	/**
+	* @brief checks if memory is part of the pool of this allocator.
+	*/
+	inline virtual bool Owns( const void* arg_ptr ) const;
+	/**
 	* @brief marks allocated memory as free in the free list.
 	* @param pointer to start of memory.
 	*/
 	inline virtual void Free( void* ) override;
 	/**
+	* @brief frees many allocations at once. faster than calling Free() for every pointer.
+	* @details sorts the blocks by address, merges neighbouring blocks and inserts them into the free list in one pass.
+	* @param array of pointers to free. nullptr entries are skipped.
+	* @param amount of pointers
+	*/
+	inline virtual void FreeBatch( void* const* arg_ptrs, size_t arg_count );
+	/**
 	* @brief Resets the free list allocator
 	* @attention Previous memory allocations might still be valid. use with care.
 	*/
@@ -676,510 +1661,7086 @@ public:
 	* @details Merges empty chunks of memory. does not move any data around. all memory allocated is still valid.
 	*/
 	inline virtual void Defragment();
+	/**
+	* @brief visits every allocated and free block in address order.
+	* @param callback
+	* @param user data passed to the callback. Default = nullptr
+	*/
+	inline virtual void Walk( HeapWalkCallback arg_callback, void* arg_user_data = nullptr ) const;
+	/**
+	* @brief gives pages that only contain free memory back to the operating system. the memory stays usable.
+	* @return amount of bytes that were resident and are released.
+	* @note only releases memory on posix platforms. returns 0 on other platforms.
+	*/
+	inline virtual size_t Trim();
+	/**
+	* @brief calls Trim() automatically when the amount of freed bytes since the last Trim() reaches the threshold.
+	* @param threshold in bytes. 0 disables automatic trimming. Default = 0
+	*/
+	inline void SetTrimThreshold( size_t arg_threshold );
 
 private:
 	void Init();
 
 	using FreeList = detail::OrderedList<detail::FreeListHeader*>;
 	FreeList* free_list_;
+	detail::SlotPool* header_pool_; // list nodes and free list headers. released at once by Reset().
 
 	Allocator * allocator_ = nullptr;
 	bool has_custom_allocator_ = false;
 	char* mem_pool_ = nullptr;
 	size_t pool_size_ = 0;
+	size_t trim_threshold_ = 0;
+	size_t freed_since_trim_ = 0;
 };
-#endif // !HSA_INCLUDE_HEADER
-
-#ifdef HSA_IMPLEMENTATION
-#ifndef HSA_NO_MALLOC
-#include <cstdlib>
-#endif // HSA_NO_MALLOC
 
-#pragma region HelperFunctions
 namespace detail
 {
-	inline size_t calcAlignedOffset( size_t arg_to_align, size_t arg_alignment )
+	/**
+	* @brief list links stored inside a free block of the buddy allocator.
+	*/
+	struct BuddyFreeBlock
 	{
-		if( arg_alignment == 0 )
-		{
-			return 0;
-		}
-		size_t aligned_offset = arg_alignment - ( arg_to_align % arg_alignment );
-		return aligned_offset == arg_alignment ? 0 : aligned_offset;
-	}
-}
-#pragma endregion
-#pragma region MallocAllocatorImplementation
-#ifndef HSA_NO_MALLOC
-void* MallocAllocator::Allocate( size_t arg_size, size_t arg_alignment )
-{
-	HSA_UNUSED(arg_alignment);
-	return malloc( arg_size );
-}
-void MallocAllocator::Free( void* arg_ptr )
-{
-	free( arg_ptr );
+		BuddyFreeBlock* previous_;
+		BuddyFreeBlock* next_;
+	};
 }
-
-void* AlignedMallocAllocator::Allocate( size_t arg_size, size_t arg_alignement )
+/**
+* @brief Binary buddy allocator for large allocations of variable size.
+* @details the pool is one block of a power of two size. a block of order n is min block size << n bytes and is split in two buddies of order n - 1.
+* every order has a free list and a bitmap with a bit per block that is set when the block is free.
+* Allocate() takes a block of the smallest order that fits and splits bigger blocks when needed, Free() merges a block with its buddy,
+* found by the XOR of its offset and its size, until the buddy is not free. both take O(log n), there is no search.
+* blocks are aligned to their size, up to the alignment of the pool (max_pool_alignment or the pool size if it is smaller).
+* allocations are rounded up to a power of two, which wastes up to half of a block.
+*/
+class BuddyAllocator : public Allocator
 {
-	return _aligned_malloc( arg_size, arg_alignement );
+public:
+	static const size_t max_pool_alignment = MIBI( 2 );
+	/**
+	* @brief Constructor
+	* @param size of the pool, rounded up to a power of two
+	* @param size of the smallest block, a power of two of at least 16 bytes. Default = 4 KiBi
+	* @param allocator to be used for the pool and the bitmaps. if nullptr will use malloc. Default = nullptr
+	*/
+	BuddyAllocator( size_t arg_pool_size, size_t arg_min_block_size = KIBI( 4 ), Allocator* arg_allocator = nullptr );
+	~BuddyAllocator();
+	BuddyAllocator( const BuddyAllocator& ) = delete;
+	BuddyAllocator& operator=( const BuddyAllocator& ) = delete;
+	/**
+	* @brief allocates a block of the smallest power of two that holds the size and the alignment.
+	* @param size
+	* @param alignment, at most the alignment of the pool. Default = 0
+	*/
+	inline virtual void* Allocate( size_t arg_size, size_t arg_alignment = 0 ) override;
+	/**
+	* @brief same as Allocate() but returns nullptr when out of memory.
+	*/
+	inline virtual void* TryAllocate( size_t arg_size, size_t arg_alignment = 0 ) override;
+	/**
+	* @brief frees a block and merges it with its free buddies.
+	*/
+	inline virtual void Free( void* arg_ptr ) override;
+	/**
+	* @brief checks if memory is part of the pool of this allocator.
+	*/
+	inline virtual bool Owns( const void* arg_ptr ) const;
+	/**
+	* @brief frees all blocks.
+	* @attention Previous memory allocations might still be valid. use with care.
+	*/
+	inline virtual void Reset();
+	/**
+	* @brief size of the block that was allocated for the pointer. at least the requested size.
+	*/
+	inline size_t BlockSize( const void* arg_ptr ) const;
+	/**
+	* @brief size of the biggest block that can be allocated right now.
+	*/
+	inline size_t LargestFreeBlock() const;
+	/**
+	* @brief amount of free bytes in all free blocks.
+	*/
+	inline size_t FreeSize() const;
+	inline size_t PoolSize() const;
+
+private:
+	inline size_t OrderOf( size_t arg_size ) const;
+	inline size_t BitOf( size_t arg_order, size_t arg_offset ) const;
+	inline void PushFree( size_t arg_order, size_t arg_offset );
+	inline void RemoveFree( size_t arg_order, size_t arg_offset );
+
+	static const size_t max_orders = 64;
+
+	Allocator* allocator_ = nullptr;
+	char* mem_pool_ = nullptr;
+	void* raw_pool_ = nullptr;			// pointer returned by malloc, mem_pool_ is aligned.
+	size_t pool_size_ = 0;
+	size_t min_block_shift_ = 0;
+	size_t order_count_ = 0;
+	size_t free_size_ = 0;
+	uint64_t free_orders_ = 0;			// bit n is set when the free list of order n is not empty.
+	detail::BuddyFreeBlock* free_lists_[max_orders] = {};
+	uint64_t* free_bits_ = nullptr;		// the bitmaps of all orders, order 0 first.
+	size_t bitmap_offsets_[max_orders] = {};
+	unsigned char* block_orders_ = nullptr; // order + 1 of the allocation that starts at every min block. 0 if no allocation starts there.
+};
+
+namespace detail
+{
+	struct CompactingBlockHeader
+	{
+		size_t size_;			// size of the block including the header.
+		uint32_t handle_index_;
+		uint32_t is_free_;
+	};
+	struct CompactingHandleEntry
+	{
+		size_t offset_;			// offset of the block header. index of the next free entry if the entry is not used.
+		uint32_t generation_;
+		uint32_t pin_count_;
+	};
+}
+/**
+* @brief Allocator that hands out handles and moves memory around to remove fragmentation.
+* @details blocks are allocated at the top of the pool. freed blocks leave gaps that are reused first fit.
+* Compact() slides live blocks together and updates the handle table. it can be spread over multiple calls with a time budget.
+* pointers returned by Resolve() are only valid until the next Allocate() or Compact(). Pin() a handle to keep its memory in place.
+* all allocations are aligned to 16 bytes.
+*/
+class CompactingAllocator
+{
+public:
+	static const size_t alignment = 16;
+	/**
+	* @brief Constuctor, allocates "arg_size" bytes memory and a handle table to be used by this allocator.
+	* @param size
+	* @param maximum amount of live handles, cannot be larger than PoolHandle::max_index + 1
+	* @param allocator to be used. if nullptr will use malloc. Default = nullptr
+	*/
+	CompactingAllocator( size_t arg_size, size_t arg_max_handles, Allocator* arg_allocator = nullptr );
+	/**
+	* @brief Destructor
+	*/
+	~CompactingAllocator();
+	/**
+	* @brief allocates memory. compacts the whole pool if no gap is big enough.
+	* @param size
+	* @return handle to the memory. invalid handle if out of memory.
+	*/
+	inline PoolHandle Allocate( size_t arg_size );
+	/**
+	* @brief frees the memory of a handle. the handle becomes stale.
+	* @param handle
+	*/
+	inline void Free( PoolHandle arg_handle );
+	/**
+	* @brief returns the memory of a handle.
+	* @return pointer that is valid until the next Allocate() or Compact(). nullptr if the handle is stale.
+	*/
+	inline void* Resolve( PoolHandle arg_handle ) const;
+	/**
+	* @brief keeps the memory of a handle in place until Unpin() is called the same amount of times.
+	* @return pointer to the memory. nullptr if the handle is stale.
+	*/
+	inline void* Pin( PoolHandle arg_handle );
+	/**
+	* @brief allows the memory of a handle to be moved again.
+	*/
+	inline void Unpin( PoolHandle arg_handle );
+	/**
+	* @brief moves live blocks together until the time budget is used. continues where the previous call stopped.
+	* @param time budget
+	* @return true if a compaction pass over the whole pool was finished.
+	*/
+	inline bool Compact( std::chrono::microseconds arg_time_budget );
+	/**
+	* @brief moves all unpinned live blocks together.
+	*/
+	inline void Compact();
+	/**
+	* @brief amount of bytes that is not used by live blocks.
+	*/
+	inline size_t FreeBytes() const;
+	/**
+	* @brief visits every block in address order.
+	*/
+	inline void Walk( HeapWalkCallback arg_callback, void* arg_user_data = nullptr ) const;
+
+private:
+	inline detail::CompactingBlockHeader* BlockAt( size_t arg_offset ) const;
+	inline detail::CompactingHandleEntry* EntryOf( PoolHandle arg_handle ) const;
+	inline bool CompactStep( size_t arg_step_count );
+	inline PoolHandle CreateHandle( size_t arg_offset );
+
+	Allocator * allocator_ = nullptr;
+	char* mem_pool_ = nullptr;
+	size_t pool_size_ = 0;
+	size_t top_ = 0;			// end of the last block. memory after top_ is free.
+	size_t used_bytes_ = 0;
+	size_t compact_offset_ = 0;	// block where the next compaction step starts.
+	detail::CompactingHandleEntry* handles_ = nullptr;
+	size_t handle_count_ = 0;
+	size_t free_handle_ = 0;	// first unused handle entry. handle_count_ if all are used.
+};
+
+namespace detail
+{
+	/**
+	* @brief arena that is kept by an ArenaPool. inherits the arena to read the used and pool size.
+	*/
+	template<class ArenaType>
+	class ArenaNode : public ArenaType
+	{
+	public:
+		ArenaNode( size_t arg_size, Allocator* arg_allocator ) :
+			ArenaType( arg_size, arg_allocator )
+		{
+		}
+		size_t UsedSize() const
+		{
+			return this->current_offset_;
+		}
+		size_t PoolSize() const
+		{
+			return this->pool_size_;
+		}
+
+		ArenaNode* next_ = nullptr;	// next arena in a free list or in the chain of a scope.
+		size_t size_class_ = 0;		// index of the free list. max_size_classes if the arena is not cached.
+	};
+}
+/**
+* @brief Recycles LinearAllocator or StackAllocator arenas so short lived scopes do not allocate their pool from the system.
+* @details arenas are cached in free lists with power of two size classes between the minimum and maximum arena size.
+* a Scope takes a reset arena from the pool and gives it back when it is destroyed.
+* when an arena of a scope is full, a bigger arena is chained to the scope.
+* the pool remembers the memory used by recent scopes and hands out arenas of that size, so chaining stops after a few scopes.
+* the pool is not thread safe. use one pool per thread.
+* @code
+* ArenaPool<LinearAllocator> arena_pool;
+* void HandleRequest()
+* {
+*	ArenaPool<LinearAllocator>::Scope scratch( arena_pool );
+*	void* buffer = scratch.Allocate( 512 );
+* } // arena is reset and back in the pool
+* @endcode
+*/
+template<class ArenaType>
+class ArenaPool
+{
+	typedef detail::ArenaNode<ArenaType> Node;
+public:
+	static const size_t max_size_classes = 32;
+
+	/**
+	* @brief Allocator that uses arenas of an ArenaPool for the lifetime of the scope.
+	*/
+	class Scope : public Allocator
+	{
+	public:
+		/**
+		* @brief takes an arena from the pool.
+		* @param pool
+		* @param expected amount of bytes used by this scope. Default = 0, the pool uses the size of recent scopes.
+		*/
+		explicit Scope( ArenaPool& arg_pool, size_t arg_size_hint = 0 );
+		Scope( const Scope& ) = delete;
+		Scope& operator=( const Scope& ) = delete;
+		/**
+		* @brief gives all arenas of this scope back to the pool.
+		*/
+		~Scope();
+		/**
+		* @brief allocates from the newest arena. chains a new arena if it is full.
+		*/
+		inline virtual void* Allocate( size_t arg_size, size_t arg_alignment = 0 ) override;
+		/**
+		* @brief same as Allocate() but returns nullptr when out of memory.
+		*/
+		inline virtual void* TryAllocate( size_t arg_size, size_t arg_alignment = 0 ) override;
+		/**
+		* @brief frees the memory in the arena it was allocated from. same rules as the ArenaType.
+		*/
+		inline virtual void Free( void* arg_ptr ) override;
+		/**
+		* @brief amount of bytes used in the arenas of this scope.
+		*/
+		inline size_t UsedSize() const;
+
+	private:
+		ArenaPool& pool_;
+		Node* current_ = nullptr; // newest arena. older arenas follow next_.
+	};
+
+	/**
+	* @brief Constructor. does not allocate arenas yet.
+	* @param size of the smallest arena. Default = 64 KiBi
+	* @param size of the largest cached arena. bigger arenas are freed when their scope ends. Default = 64 MiBi
+	* @param allocator to be used for the arenas. if nullptr will use malloc. Default = nullptr
+	*/
+	ArenaPool( size_t arg_min_arena_size = KIBI( 64 ), size_t arg_max_arena_size = MIBI( 64 ), Allocator* arg_allocator = nullptr );
+	/**
+	* @brief Destructor. all scopes have to be destroyed before the pool.
+	*/
+	~ArenaPool();
+	/**
+	* @brief frees all arenas that are not used by a scope.
+	*/
+	inline void ReleaseCached();
+	/**
+	* @brief size of the arena a scope without size hint starts with.
+	*/
+	inline size_t TypicalSize() const;
+
+private:
+	inline size_t SizeClassOf( size_t arg_size ) const;
+	inline Node* Acquire( size_t arg_size );
+	inline void Release( Node* arg_node );
+	inline void DestroyNode( Node* arg_node );
+	inline void Record( size_t arg_footprint );
+
+	Allocator * allocator_ = nullptr;
+	size_t min_arena_size_ = 0;
+	size_t size_class_count_ = 0;
+	size_t typical_size_ = 0;	// decaying maximum of the memory used by recent scopes.
+	size_t active_count_ = 0;	// arenas that are used by a scope.
+	Node* free_lists_[max_size_classes] = {};
+};
+
+namespace detail
+{
+	/**
+	* @brief lock free multiple producer single consumer list of freed blocks.
+	* @details the first word of a freed block links it to the next block. producers push, the owner takes the whole list at once.
+	*/
+	class alignas( 64 ) RemoteFreeList
+	{
+	public:
+		inline void Push( void* arg_ptr );
+		inline void* TakeAll();
+		inline bool IsEmpty() const;
+	private:
+		std::atomic<void*> head_ = { nullptr };
+		char padding_[64 - sizeof( std::atomic<void*> )]; // keeps the owner's data out of the cache line.
+	};
+}
+/**
+* @brief owner thread mode for an allocator. other threads can free memory without a lock.
+* @details the thread that creates the allocator, or calls SetOwner(), owns the pool. only the owner allocates.
+* frees from the owner go to the pool directly. frees from other threads are pushed on a lock free remote free list.
+* the owner frees the remote list in batches on its next allocation or when Collect() is called.
+* PoolType has to be an Allocator with Free( void* ), like the StackAllocator or FreeListAllocator.
+* allocations are at least sizeof( void* ) bytes because a freed block stores the link of the remote free list.
+* @code
+* RemoteFreeAllocator<FreeListAllocator> message_alloc( MIBI( 16 ) );
+* void* message = message_alloc.Allocate( 256 );	// producer thread
+* message_alloc.Free( message );					// any thread
+* @endcode
+*/
+template<class PoolType>
+class RemoteFreeAllocator : public Allocator
+{
+public:
+	/**
+	* @brief Constructor. the calling thread becomes the owner.
+	* @param arguments forwarded to the constructor of the pool.
+	*/
+	template<class... Args>
+	explicit RemoteFreeAllocator( Args&&... arg_args );
+	/**
+	* @brief Destructor. frees blocks on the remote free list. no other thread may free memory anymore.
+	*/
+	~RemoteFreeAllocator();
+	/**
+	* @brief allocates from the pool. only the owner thread can allocate.
+	*/
+	inline virtual void* Allocate( size_t arg_size, size_t arg_alignment = 0 ) override;
+	/**
+	* @brief same as Allocate() but returns nullptr when out of memory.
+	*/
+	inline virtual void* TryAllocate( size_t arg_size, size_t arg_alignment = 0 ) override;
+	/**
+	* @brief frees memory. can be called from any thread.
+	*/
+	inline virtual void Free( void* arg_ptr ) override;
+	/**
+	* @brief frees all blocks on the remote free list. only the owner thread can collect.
+	*/
+	inline void Collect();
+	/**
+	* @brief makes the calling thread the owner of the pool.
+	* @attention the previous owner may not use the allocator anymore.
+	*/
+	inline void SetOwner();
+	/**
+	* @brief true if the calling thread owns the pool.
+	*/
+	inline bool IsOwner() const;
+	/**
+	* @brief the pool. only use it from the owner thread.
+	*/
+	inline PoolType& Pool();
+
+private:
+	detail::RemoteFreeList remote_frees_;
+	std::atomic<std::thread::id> owner_;	// read by Free() on any thread while SetOwner() can change it.
+	PoolType pool_;
+};
+/**
+* @brief owner thread mode for the bitmap allocator. same as RemoteFreeAllocator but allocates one chunk at a time.
+*/
+template<size_t ChunkSize>
+class RemoteFreeAllocator<BitmapAllocator<ChunkSize>>
+{
+	static_assert( ChunkSize >= sizeof( void* ), "chunk has to be able to hold the link of the remote free list" );
+public:
+	template<class... Args>
+	explicit RemoteFreeAllocator( Args&&... arg_args );
+	~RemoteFreeAllocator();
+	/**
+	* @brief allocates one chunk. only the owner thread can allocate.
+	*/
+	inline void* Allocate();
+	/**
+	* @brief same as Allocate() but returns nullptr when all chunks are used.
+	*/
+	inline void* TryAllocate();
+	/**
+	* @brief frees one chunk. can be called from any thread.
+	*/
+	inline void Free( void* arg_ptr );
+	inline void Collect();
+	inline void SetOwner();
+	inline bool IsOwner() const;
+	inline BitmapAllocator<ChunkSize>& Pool();
+
+private:
+	detail::RemoteFreeList remote_frees_;
+	std::atomic<std::thread::id> owner_;
+	BitmapAllocator<ChunkSize> pool_;
+};
+namespace detail
+{
+	/**
+	* @brief page aligned buffers and bookkeeping of an IOBufferPool. freed after the bitmap allocator that uses them.
+	*/
+	class IOBufferMemory
+	{
+	public:
+		IOBufferMemory( size_t arg_buffers_size, size_t arg_alignment, size_t arg_bookkeeping_size, Allocator* arg_allocator );
+		~IOBufferMemory();
+		IOBufferMemory( const IOBufferMemory& ) = delete;
+		IOBufferMemory& operator=( const IOBufferMemory& ) = delete;
+
+		Allocator* allocator_ = nullptr;
+		char* buffers_ = nullptr;
+		void* bookkeeping_ = nullptr;
+	};
+}
+/**
+* @brief pool of page aligned I/O buffers of BufferSize bytes that are handed out as reference counted slices.
+* @details the buffers are chunks of a BitmapAllocator on a page aligned pool, so they can be used for O_DIRECT reads.
+* a Slice is a view on a part of a buffer. copies and sub slices of a slice share the buffer, which is freed when the last slice is destroyed.
+* the thread that creates the pool acquires buffers. slices can be released on any thread, like the RemoteFreeAllocator.
+* AcquireBatch() takes multiple buffers at once for batched submission with readv or io_uring.
+* @code
+* IOBufferPool<KIBI( 64 )> io_pool( 256 );
+* IOBufferPool<KIBI( 64 )>::Slice slices[8];
+* size_t count = io_pool.AcquireBatch( slices, 8 );
+* iovec vectors[8];
+* for( size_t i = 0; i < count; i++ )
+* {
+*	vectors[i].iov_base = slices[i].Data();
+*	vectors[i].iov_len = slices[i].Size();
+* }
+* ssize_t read_size = readv( file, vectors, static_cast< int >( count ) );
+* @endcode
+*/
+template<size_t BufferSize = KIBI( 64 )>
+class IOBufferPool
+{
+public:
+	static const size_t page_size = 4096;
+	static const size_t buffer_size = BufferSize;
+	static_assert( BufferSize % page_size == 0, "buffer size has to be a multiple of the page size" );
+
+	/**
+	* @brief reference counted view on a part of a buffer.
+	*/
+	class Slice
+	{
+	public:
+		Slice() = default;
+		Slice( const Slice& arg_other );
+		Slice( Slice&& arg_other ) noexcept;
+		Slice& operator=( const Slice& arg_other );
+		Slice& operator=( Slice&& arg_other ) noexcept;
+		/**
+		* @brief releases the buffer when this is the last slice of it.
+		*/
+		~Slice();
+		inline char* Data() const;
+		inline size_t Size() const;
+		inline explicit operator bool() const;
+		/**
+		* @brief a slice of a part of this slice that shares the buffer.
+		* @param offset from the start of this slice
+		* @param size, cut off at the end of this slice
+		*/
+		inline Slice SubSlice( size_t arg_offset, size_t arg_size ) const;
+		/**
+		* @brief amount of slices that share the buffer.
+		*/
+		inline uint32_t UseCount() const;
+		/**
+		* @brief releases the buffer and makes the slice empty.
+		*/
+		inline void Reset();
+
+	private:
+		friend class IOBufferPool;
+		Slice( IOBufferPool* arg_pool, size_t arg_index, size_t arg_offset, size_t arg_size );
+
+		IOBufferPool* pool_ = nullptr;
+		size_t index_ = 0;
+		size_t offset_ = 0;
+		size_t size_ = 0;
+	};
+
+	/**
+	* @brief Constructor. the calling thread acquires buffers.
+	* @param amount of buffers, rounded up to a multiple of 8
+	* @param allocator to be used for the buffers. has to support page alignment. if nullptr will use AlignedMallocAllocator. Default = nullptr
+	*/
+	IOBufferPool( size_t arg_buffer_count, Allocator* arg_allocator = nullptr );
+	/**
+	* @brief Destructor. all slices have to be released before.
+	*/
+	~IOBufferPool() = default;
+	IOBufferPool( const IOBufferPool& ) = delete;
+	IOBufferPool& operator=( const IOBufferPool& ) = delete;
+	/**
+	* @brief takes a free buffer. only the owner thread can acquire.
+	* @return a slice of the whole buffer. empty if all buffers are used.
+	*/
+	inline Slice Acquire();
+	/**
+	* @brief takes up to count buffers.
+	* @return amount of buffers that were acquired.
+	*/
+	inline size_t AcquireBatch( Slice* arg_slices, size_t arg_count );
+	/**
+	* @brief frees buffers that were released on other threads. only the owner thread can collect.
+	*/
+	inline void Collect();
+	/**
+	* @brief checks if memory is part of a buffer of this pool.
+	*/
+	inline bool Owns( const void* arg_ptr ) const;
+	inline size_t BufferCount() const;
+
+private:
+	inline void Release( size_t arg_index );
+
+	size_t buffer_count_ = 0;
+	detail::IOBufferMemory memory_;
+	std::atomic<uint32_t>* ref_counts_ = nullptr;
+	RemoteFreeAllocator<BitmapAllocator<BufferSize>> pool_;
+};
+
+#ifndef HSA_NO_MALLOC
+namespace detail
+{
+	class FrameCache;
+	/**
+	* @brief header at the start of a slab of coroutine frames. slabs are aligned to their size so a frame finds its slab by masking its address.
+	*/
+	struct FrameSlab
+	{
+		FrameCache* owner_;
+		size_t size_class_;
+		FrameSlab* next_;		// next slab of the same cache.
+	};
+	/**
+	* @brief thread local size class free lists for coroutine frames.
+	* @details frames of one size class are carved from 64 KiBi slabs like the chunks of a bitmap allocator.
+	* a frame that is freed on another thread is pushed on the remote free list of the cache that owns its slab.
+	* when the thread of a cache exits while frames are alive, the cache is orphaned and the last free destroys it.
+	*/
+	class FrameCache
+	{
+	public:
+		static const size_t slab_size = 64 * 1024;
+		static const size_t slab_header_size = 64;		// keeps frames 64 byte aligned.
+		static const size_t min_frame_size = 64;
+		static const size_t size_class_count = 7;		// 64 to 4096 bytes.
+		static const size_t max_frame_size = min_frame_size << ( size_class_count - 1 );
+
+		~FrameCache();
+		inline void* Allocate( size_t arg_size );
+		inline void Free( void* arg_ptr );
+		inline void Collect();
+		inline size_t LiveFrames() const;
+		/**
+		* @brief called when the thread of the cache exits. the cache destroys itself when the last frame is freed.
+		*/
+		inline void Orphan();
+		/**
+		* @brief destroys a cache that was allocated with malloc.
+		*/
+		static inline void Destroy( FrameCache* arg_cache );
+		/**
+		* @brief used once the cache of the thread was orphaned, for frames of other thread local objects that are destroyed later.
+		* @details a frame allocated after exit gets an orphaned cache of its own. a frame freed after exit goes to the remote free
+		* list of the cache that owns its slab, so the orphaned cache of the thread still sees its last frame.
+		*/
+		static inline void* AllocateAfterExit( size_t arg_size );
+		static inline void FreeAfterExit( void* arg_ptr );
+
+	private:
+		inline void Refill( size_t arg_size_class );
+		inline void RemoteFree( void* arg_ptr );
+
+		void* free_frames_[size_class_count] = {};	// singly linked lists of free frames.
+		FrameSlab* slabs_ = nullptr;
+		size_t live_frames_ = 0;
+		size_t remote_collected_ = 0;				// frames freed by other threads that were collected.
+		std::atomic<size_t> orphan_count_ = { 0 };	// decremented by every remote free. reaches 0 when an orphaned cache has no frames left.
+		RemoteFreeList remote_frees_;
+	};
+}
+/**
+* @brief coroutine frame allocation from thread local size classes.
+* @details frames up to 4 KiBi are taken from the free list of their size class. bigger frames use malloc.
+* frames can be destroyed on any thread. when a thread exits while its frames are still alive, its slabs are freed with the last frame.
+*/
+struct CoroutineFramePool
+{
+	static inline void* Allocate( size_t arg_size );
+	static inline void Free( void* arg_ptr, size_t arg_size );
+};
+/**
+* @brief coroutine frame allocation from a thread local StackAllocator.
+* @details only use this when coroutines are destroyed in the reverse order of their creation on the same thread,
+* like nested awaits that complete before their caller. frames that do not fit use malloc.
+*/
+struct CoroutineFrameStack
+{
+	static const size_t stack_size = 1024 * 1024;
+
+	static inline void* Allocate( size_t arg_size );
+	static inline void Free( void* arg_ptr, size_t arg_size );
+};
+/**
+* @brief mixin for the promise type of a coroutine. the coroutine frame is allocated with FrameAllocator instead of the global operator new.
+* @code
+* struct Task
+* {
+*	struct promise_type : CoroutineFrameAllocator<>
+*	{
+*		...
+*	};
+* };
+* @endcode
+*/
+template<class FrameAllocator = CoroutineFramePool>
+struct CoroutineFrameAllocator
+{
+	static void* operator new( size_t arg_size )
+	{
+		return FrameAllocator::Allocate( arg_size );
+	}
+	static void operator delete( void* arg_ptr, size_t arg_size )
+	{
+		FrameAllocator::Free( arg_ptr, arg_size );
+	}
+};
+#endif // !HSA_NO_MALLOC
+
+/**
+* @brief pointer that stores the distance from itself to the object it points to.
+* @details an OffsetPtr stays valid when the memory that holds it is mapped at another address,
+* as long as the object it points to is inside the same mapping. use it for pointers stored inside a persistent or shared heap.
+*/
+template<class T>
+class OffsetPtr
+{
+public:
+	OffsetPtr() = default;
+	OffsetPtr( T* arg_ptr )
+	{
+		Set( arg_ptr );
+	}
+	OffsetPtr( const OffsetPtr& arg_rhs )
+	{
+		Set( arg_rhs.Get() );
+	}
+	OffsetPtr& operator=( const OffsetPtr& arg_rhs )
+	{
+		Set( arg_rhs.Get() );
+		return *this;
+	}
+	OffsetPtr& operator=( T* arg_ptr )
+	{
+		Set( arg_ptr );
+		return *this;
+	}
+	T* Get() const
+	{
+		return offset_ == 0 ? nullptr : reinterpret_cast< T* >( reinterpret_cast< intptr_t >( this ) + offset_ );
+	}
+	T* operator->() const
+	{
+		return Get();
+	}
+	explicit operator bool() const
+	{
+		return offset_ != 0;
+	}
+
+private:
+	void Set( T* arg_ptr )
+	{
+		offset_ = arg_ptr == nullptr ? 0 : reinterpret_cast< intptr_t >( arg_ptr ) - reinterpret_cast< intptr_t >( this );
+	}
+
+	intptr_t offset_ = 0; // 0 is nullptr. an OffsetPtr never points to itself.
+};
+
+namespace detail
+{
+	/**
+	* @brief header at the start of every free block in an OffsetHeap.
+	*/
+	struct OffsetFreeListHeader
+	{
+		OffsetPtr<OffsetFreeListHeader> next_;
+		size_t size_;
+	};
+	/**
+	* @brief free list heap that only contains offsets. it lives at the start of the memory it manages.
+	* @details the free list is stored inside the free blocks, ordered by address. used blocks have a FreeListAllocationHeader.
+	* the heap can be mapped at any address and used without rebuilding any state.
+	*/
+	struct OffsetHeap
+	{
+		static const size_t root_count = 16;
+		static const uint64_t magic = 0x3150414548415348ull; // "HSAHEAP1"
+		static const uint32_t version = 2; // changes when the layout of the heap changes.
+
+		/**
+		* @brief creates an empty heap in memory
+		* @param memory, aligned to 16 bytes
+		* @param size of the memory including the heap
+		*/
+		static OffsetHeap* Create( void* arg_memory, size_t arg_size );
+		/**
+		* @brief checks if memory contains a heap created with Create() with the same version and layout.
+		*/
+		static bool IsValid( const void* arg_memory, size_t arg_size );
+
+		inline void* Allocate( size_t arg_size, size_t arg_alignment );
+		inline void Free( void* arg_ptr );
+		inline void Reset();
+		inline void Walk( HeapWalkCallback arg_callback, void* arg_user_data ) const;
+		inline char* Pool() const;
+		inline bool Contains( const void* arg_ptr ) const;
+
+		uint64_t magic_;
+		uint32_t version_;
+		uint32_t header_size_;	// sizeof( OffsetHeap ) of the process that created the heap.
+		size_t mapping_size_;
+		size_t pool_size_;
+		OffsetPtr<OffsetFreeListHeader> free_list_;
+		OffsetPtr<void> roots_[root_count];
+	};
+}
+#ifdef HSA_POSIX
+/**
+* @brief Free list allocator with a pool in a memory mapped file.
+* @details all bookkeeping is stored in the file as offsets. reopening the file maps the heap and its roots without rebuilding anything.
+* pointers stored inside the heap have to be OffsetPtr's or offsets. allocations are not synchronized between processes.
+* @note only available on posix platforms.
+*/
+class PersistentFreeListAllocator : public Allocator
+{
+public:
+	static const size_t root_count = detail::OffsetHeap::root_count;
+	/**
+	* @brief opens the heap in a file. creates a new heap if the file does not exist or is empty.
+	* @details a file that is not empty and does not contain a heap of this version is not changed. the constructor fails with
+	* an assert and IsOpen() returns false.
+	* @param path to the file
+	* @param size of the file in bytes, used when a new heap is created.
+	*/
+	PersistentFreeListAllocator( const char* arg_path, size_t arg_size );
+	/**
+	* @brief Destructor, unmaps the file. memory is written back by the operating system.
+	*/
+	~PersistentFreeListAllocator();
+	/**
+	* @brief Allocates requested size of memory in the heap
+	* @param size
+	* @param alignment
+	* @return pointer to memory
+	*/
+	inline virtual void* Allocate( size_t arg_size, size_t arg_alignment = 0 ) override;
+	/**
+	* @brief gives memory back to the heap. merges with neighbouring free blocks.
+	* @param pointer to start of memory.
+	*/
+	inline virtual void Free( void* arg_ptr ) override;
+	/**
+	* @brief Resets the heap and clears all roots
+	* @attention Previous memory allocations might still be valid. use with care.
+	*/
+	inline virtual void Reset();
+	/**
+	* @brief visits every allocated and free block in address order.
+	*/
+	inline virtual void Walk( HeapWalkCallback arg_callback, void* arg_user_data = nullptr ) const;
+	/**
+	* @brief stores a pointer into the heap that can be retrieved after reopening the file.
+	* @param index smaller than root_count
+	* @param pointer to memory allocated from this heap or nullptr
+	*/
+	inline void SetRoot( size_t arg_index, void* arg_ptr );
+	/**
+	* @brief returns a pointer stored with SetRoot(). nullptr if never set.
+	*/
+	inline void* GetRoot( size_t arg_index ) const;
+	/**
+	* @brief writes all changes to the file and waits until they are written.
+	*/
+	inline void Flush();
+	/**
+	* @brief true if an existing heap was opened instead of created.
+	*/
+	inline bool IsWarmStart() const;
+	/**
+	* @brief true if a heap was opened or created.
+	*/
+	inline bool IsOpen() const;
+
+private:
+	detail::OffsetHeap* heap_ = nullptr;
+	size_t mapping_size_ = 0;
+	int file_ = -1;
+	bool is_warm_start_ = false;
+};
+
+namespace detail
+{
+	struct SharedHeapHeader;
+}
+/**
+* @brief Free list allocator with a pool in a posix shared memory segment.
+* @details every process that opens the segment with the same name shares the heap. allocations are protected with a
+* process shared robust mutex. pointers are different in every process, send offsets from ToOffset() to other processes
+* and turn them back into pointers with FromOffset().
+* when a process dies while it holds the lock the heap may be half changed. the heap is then marked broken, allocation and
+* free fail in every process until Reset() is called.
+* @note only available on posix platforms. link with -lrt -pthread on older systems.
+*/
+class SharedMemoryAllocator : public Allocator
+{
+public:
+	static const size_t root_count = detail::OffsetHeap::root_count;
+	/**
+	* @brief time a process that opens an existing segment waits for the creator to initialize it.
+	*/
+	static const uint32_t open_timeout_ms = 5000;
+	/**
+	* @brief opens the shared memory segment. creates and initializes it if it does not exist yet.
+	* @details fails with an assert and IsOpen() returns false when the segment cannot be created, or when the creator
+	* did not finish within open_timeout_ms. a creator that fails removes the name of the segment again.
+	* @param name of the segment, starts with a '/'
+	* @param size of the segment in bytes, used when the segment is created.
+	*/
+	SharedMemoryAllocator( const char* arg_name, size_t arg_size );
+	/**
+	* @brief Destructor, unmaps the segment. the segment exists until Unlink() is called.
+	*/
+	~SharedMemoryAllocator();
+	/**
+	* @brief removes the name of a segment. the memory is released when the last process unmapped it.
+	*/
+	static void Unlink( const char* arg_name );
+	/**
+	* @brief Allocates requested size of memory in the shared heap
+	* @param size
+	* @param alignment
+	* @return pointer to memory
+	*/
+	inline virtual void* Allocate( size_t arg_size, size_t arg_alignment = 0 ) override;
+	/**
+	* @brief gives memory back to the shared heap. can be called by any process.
+	* @param pointer to start of memory.
+	*/
+	inline virtual void Free( void* arg_ptr ) override;
+	/**
+	* @brief Resets the shared heap for all processes and clears all roots. also makes a broken heap usable again.
+	* @attention Previous memory allocations might still be valid. use with care.
+	*/
+	inline virtual void Reset();
+	/**
+	* @brief visits every allocated and free block in address order. the heap is locked while walking.
+	*/
+	inline virtual void Walk( HeapWalkCallback arg_callback, void* arg_user_data = nullptr );
+	/**
+	* @brief converts a pointer into the segment to an offset that is valid in every process. nullptr becomes 0.
+	*/
+	inline size_t ToOffset( const void* arg_ptr ) const;
+	/**
+	* @brief converts an offset from ToOffset() to a pointer in this process. 0 becomes nullptr.
+	*/
+	inline void* FromOffset( size_t arg_offset ) const;
+	/**
+	* @brief stores a pointer into the heap that every process can retrieve with GetRoot().
+	* @param index smaller than root_count
+	* @param pointer to memory allocated from this heap or nullptr
+	*/
+	inline void SetRoot( size_t arg_index, void* arg_ptr );
+	/**
+	* @brief returns a pointer stored with SetRoot(). nullptr if never set.
+	*/
+	inline void* GetRoot( size_t arg_index );
+	/**
+	* @brief true if this process created the segment.
+	*/
+	inline bool IsCreator() const;
+	/**
+	* @brief true if the segment was opened or created.
+	*/
+	inline bool IsOpen() const;
+	/**
+	* @brief true if a process died while it changed the heap. Reset() makes the heap usable again.
+	*/
+	inline bool IsBroken() const;
+
+private:
+	detail::SharedHeapHeader* shared_header_ = nullptr;
+	detail::OffsetHeap* heap_ = nullptr;
+	size_t mapping_size_ = 0;
+	bool is_creator_ = false;
+};
+#endif // HSA_POSIX
+
+#ifdef HSA_PMR
+/**
+* @brief std::pmr::memory_resource that allocates from an HSA allocator. falls back to an upstream resource when the pool is full.
+* @details works with the stack, bitmap and free list allocator. memory is given back to the pool or the upstream resource it came from.
+* MemoryResource<LinearAllocator> (MonotonicResource) never frees pool memory.
+* @note only available with c++17 or later.
+*/
+template<class PoolType>
+class MemoryResource : public std::pmr::memory_resource
+{
+public:
+	/**
+	* @brief constructor
+	* @param allocator used for allocating memory
+	* @param resource used when the allocator is out of memory. Default = std::pmr::get_default_resource()
+	*/
+	explicit MemoryResource( PoolType* arg_pool, std::pmr::memory_resource* arg_upstream = std::pmr::get_default_resource() ) :
+		pool_( arg_pool ),
+		upstream_( arg_upstream )
+	{
+	}
+	PoolType* Pool() const
+	{
+		return pool_;
+	}
+	std::pmr::memory_resource* Upstream() const
+	{
+		return upstream_;
+	}
+
+protected:
+	void* do_allocate( size_t arg_size, size_t arg_alignment ) override
+	{
+		void* return_ptr = pool_->TryAllocate( arg_size, arg_alignment );
+		return return_ptr != nullptr ? return_ptr : upstream_->allocate( arg_size, arg_alignment );
+	}
+	void do_deallocate( void* arg_ptr, size_t arg_size, size_t arg_alignment ) override
+	{
+		if( pool_->Owns( arg_ptr ) )
+		{
+			pool_->Free( arg_ptr );
+		}
+		else
+		{
+			upstream_->deallocate( arg_ptr, arg_size, arg_alignment );
+		}
+	}
+	bool do_is_equal( const std::pmr::memory_resource& arg_rhs ) const noexcept override
+	{
+		return this == &arg_rhs;
+	}
+
+	PoolType* pool_;
+	std::pmr::memory_resource* upstream_;
+};
+/**
+* @brief memory resource for the linear allocator. deallocating pool memory does nothing, reset the linear allocator to reuse it.
+*/
+template<>
+class MemoryResource<LinearAllocator> : public std::pmr::memory_resource
+{
+public:
+	explicit MemoryResource( LinearAllocator* arg_pool, std::pmr::memory_resource* arg_upstream = std::pmr::get_default_resource() ) :
+		pool_( arg_pool ),
+		upstream_( arg_upstream )
+	{
+	}
+	LinearAllocator* Pool() const
+	{
+		return pool_;
+	}
+	std::pmr::memory_resource* Upstream() const
+	{
+		return upstream_;
+	}
+
+protected:
+	void* do_allocate( size_t arg_size, size_t arg_alignment ) override
+	{
+		void* return_ptr = pool_->TryAllocate( arg_size, arg_alignment );
+		return return_ptr != nullptr ? return_ptr : upstream_->allocate( arg_size, arg_alignment );
+	}
+	void do_deallocate( void* arg_ptr, size_t arg_size, size_t arg_alignment ) override
+	{
+		if( pool_->Owns( arg_ptr ) == false )
+		{
+			upstream_->deallocate( arg_ptr, arg_size, arg_alignment );
+		}
+	}
+	bool do_is_equal( const std::pmr::memory_resource& arg_rhs ) const noexcept override
+	{
+		return this == &arg_rhs;
+	}
+
+	LinearAllocator* pool_;
+	std::pmr::memory_resource* upstream_;
+};
+using MonotonicResource = MemoryResource<LinearAllocator>;
+/**
+* @brief memory resource for the bitmap allocator. requests that do not fit in a chunk go to the upstream resource.
+*/
+template<size_t ChunkSize>
+class MemoryResource<BitmapAllocator<ChunkSize>> : public std::pmr::memory_resource
+{
+public:
+	explicit MemoryResource( BitmapAllocator<ChunkSize>* arg_pool, std::pmr::memory_resource* arg_upstream = std::pmr::get_default_resource() ) :
+		pool_( arg_pool ),
+		upstream_( arg_upstream )
+	{
+	}
+	BitmapAllocator<ChunkSize>* Pool() const
+	{
+		return pool_;
+	}
+	std::pmr::memory_resource* Upstream() const
+	{
+		return upstream_;
+	}
+
+protected:
+	void* do_allocate( size_t arg_size, size_t arg_alignment ) override
+	{
+		if( arg_size <= ChunkSize )
+		{
+			void* return_ptr = pool_->TryAllocate();
+			if( return_ptr != nullptr && reinterpret_cast< size_t >( return_ptr ) % arg_alignment == 0 )
+			{
+				return return_ptr;
+			}
+			if( return_ptr != nullptr )
+			{
+				pool_->Free( return_ptr ); // chunks are not aligned enough.
+			}
+		}
+		return upstream_->allocate( arg_size, arg_alignment );
+	}
+	void do_deallocate( void* arg_ptr, size_t arg_size, size_t arg_alignment ) override
+	{
+		if( pool_->Owns( arg_ptr ) )
+		{
+			pool_->Free( arg_ptr );
+		}
+		else
+		{
+			upstream_->deallocate( arg_ptr, arg_size, arg_alignment );
+		}
+	}
+	bool do_is_equal( const std::pmr::memory_resource& arg_rhs ) const noexcept override
+	{
+		return this == &arg_rhs;
+	}
+
+	BitmapAllocator<ChunkSize>* pool_;
+	std::pmr::memory_resource* upstream_;
+};
+#endif // HSA_PMR
+
+/**
+* @brief Turns the blocks of a heap walk into statistics, a size histogram and a fragmentation map.
+* @details pass HeapWalkReport::Collect as callback and a pointer to the report as user data to any Walk() function.
+* histogram buckets are powers of two. bucket i holds blocks with a size in [2^i, 2^(i+1)).
+*/
+class HeapWalkReport
+{
+public:
+	static const size_t histogram_bucket_count = sizeof( size_t ) * 8;
+	static const size_t max_map_cells = 1024;
+	/**
+	* @brief Constructor
+	* @param size of the walked pool in bytes
+	* @param amount of cells in the fragmentation map. Default = 64, max = max_map_cells
+	*/
+	HeapWalkReport( size_t arg_pool_size, size_t arg_map_cells = 64 );
+	/**
+	* @brief HeapWalkCallback that adds a block to the report passed as user data.
+	*/
+	static void Collect( const HeapBlock& arg_block, void* arg_report );
+	/**
+	* @brief adds a block to the report
+	*/
+	void Add( const HeapBlock& arg_block );
+	/**
+	* @brief fraction of free memory that is not part of the largest free block. 0 is not fragmented, close to 1 is heavily fragmented.
+	*/
+	float Fragmentation() const;
+	/**
+	* @brief writes one character per cell. '.' = free, '-' = less than half used, '+' = more than half used, '#' = fully used.
+	* @param buffer of at least map cell count + 1 bytes. the result is null terminated.
+	* @param size of the buffer in bytes
+	* @return amount of characters written without the null terminator.
+	*/
+	size_t WriteFragmentationMap( char* arg_buffer, size_t arg_buffer_size ) const;
+
+	size_t live_bytes_ = 0;
+	size_t free_bytes_ = 0;
+	size_t overhead_bytes_ = 0;	// header and padding bytes of live blocks
+	size_t live_block_count_ = 0;
+	size_t free_block_count_ = 0;
+	size_t largest_free_block_ = 0;
+	size_t live_histogram_[histogram_bucket_count] = {};
+	size_t free_histogram_[histogram_bucket_count] = {};
+
+private:
+	size_t pool_size_ = 0;
+	size_t map_cells_ = 0;
+	size_t cell_used_bytes_[max_map_cells] = {};
+};
+
+/**
+* @brief log bucketed histogram of latencies, like a HDR histogram with 4 bits of precision.
+* @details values below 16 have their own bucket. bigger values share a bucket with values that have the same 5 highest bits,
+* so the value of a bucket is at most 6.25% off. every bucket is an atomic counter, so threads can record into the same histogram.
+* the unit is nanoseconds, or cpu ticks when HSA_LATENCY_RDTSC is defined.
+*/
+class LatencyHistogram
+{
+public:
+	static const size_t sub_bucket_bits = 4;
+	static const size_t sub_bucket_count = size_t( 1 ) << sub_bucket_bits;
+	static const size_t bucket_count = ( 64 - sub_bucket_bits + 1 ) * sub_bucket_count;
+
+	LatencyHistogram();
+	LatencyHistogram( const LatencyHistogram& arg_other );
+	LatencyHistogram& operator=( const LatencyHistogram& arg_other );
+	/**
+	* @brief adds one value. lock free.
+	*/
+	inline void Record( uint64_t arg_value );
+	/**
+	* @brief adds all values of another histogram.
+	*/
+	void Merge( const LatencyHistogram& arg_other );
+	void Reset();
+	uint64_t Count() const;
+	uint64_t Max() const;
+	double Mean() const;
+	/**
+	* @brief highest value of the bucket that holds the given percentile.
+	* @param percentile in [0, 100], like 99.9
+	* @return 0 if the histogram is empty
+	*/
+	uint64_t ValueAtPercentile( double arg_percentile ) const;
+	/**
+	* @brief writes count, mean, max, p50, p90, p99, p99.9, p99.99 and one line per used bucket as text.
+	* @details a bucket line is the highest value of the bucket and its count, separated by a tab.
+	* @param buffer for the text. the result is null terminated and cut off when the buffer is too small.
+	* @param size of the buffer in bytes
+	* @return amount of characters written without the null terminator.
+	*/
+	size_t Write( char* arg_buffer, size_t arg_buffer_size ) const;
+	/**
+	* @brief the count of a single bucket.
+	*/
+	uint64_t BucketCount( size_t arg_bucket ) const;
+	static inline size_t BucketOf( uint64_t arg_value );
+	/**
+	* @brief highest value that falls in the bucket.
+	*/
+	static uint64_t BucketMaxValue( size_t arg_bucket );
+
+private:
+	std::atomic<uint64_t> buckets_[bucket_count];
+	std::atomic<uint64_t> sum_;
+	std::atomic<uint64_t> max_;
+};
+#ifndef HSA_NO_MALLOC
+namespace detail
+{
+	/**
+	* @brief allocate and free histograms per thread. a shard is created with malloc on the first call of a thread.
+	* @details threads are spread over max_shards shards. threads only share a shard when more than max_shards threads record.
+	*/
+	class LatencyShards
+	{
+	public:
+		static const size_t max_shards = 64;
+
+		~LatencyShards();
+		inline void RecordAllocate( uint64_t arg_latency );
+		inline void RecordFree( uint64_t arg_latency );
+		inline void MergeAllocate( LatencyHistogram& arg_histogram ) const;
+		inline void MergeFree( LatencyHistogram& arg_histogram ) const;
+		inline void Reset();
+
+	private:
+		struct Shard
+		{
+			LatencyHistogram allocate_;
+			LatencyHistogram free_;
+		};
+		inline Shard* LocalShard();
+
+		std::atomic<Shard*> shards_[max_shards] = {};
+	};
+}
+/**
+* @brief measures the latency of every Allocate, TryAllocate and Free call of a pool.
+* @details every call reads the clock twice and adds the difference to a histogram of the calling thread.
+* AllocateLatency() and FreeLatency() merge the histograms of all threads, which can be done while other threads allocate.
+* the clock is std::chrono::steady_clock. define HSA_LATENCY_RDTSC to use the cheaper rdtsc instruction on x86, which measures in cpu ticks.
+* @code
+* LatencyTrackingAllocator<FreeListAllocator> alloc( MIBI( 16 ) );
+* ...
+* if( alloc.AllocateLatency().ValueAtPercentile( 99.9 ) > 1000 ) {} // p99.9 above 1 microsecond
+* @endcode
+*/
+template<class PoolType>
+class LatencyTrackingAllocator : public Allocator
+{
+public:
+	/**
+	* @brief Constructor
+	* @param arguments forwarded to the constructor of the pool.
+	*/
+	template<class... Args>
+	explicit LatencyTrackingAllocator( Args&&... arg_args );
+	inline virtual void* Allocate( size_t arg_size, size_t arg_alignment = 0 ) override;
+	inline virtual void* TryAllocate( size_t arg_size, size_t arg_alignment = 0 ) override;
+	inline virtual void Free( void* arg_ptr ) override;
+	/**
+	* @brief forwarded to the pool. recorded as allocate latency.
+	*/
+	inline virtual bool TryExpand( void* arg_ptr, size_t arg_size, size_t arg_new_size ) override;
+	/**
+	* @brief forwarded to the pool. recorded as free latency.
+	*/
+	inline virtual void FreeSized( void* arg_ptr, size_t arg_size ) override;
+	/**
+	* @brief latencies of Allocate, TryAllocate and TryExpand of all threads.
+	*/
+	inline LatencyHistogram AllocateLatency() const;
+	/**
+	* @brief latencies of Free of all threads.
+	*/
+	inline LatencyHistogram FreeLatency() const;
+	/**
+	* @brief clears the histograms. values recorded at the same time by other threads can be lost.
+	*/
+	inline void ResetLatency();
+	inline PoolType& Pool();
+
+private:
+	detail::LatencyShards latency_;
+	PoolType pool_;
+};
+/**
+* @brief latency tracking for the bitmap allocator. same as LatencyTrackingAllocator but allocates one chunk at a time.
+*/
+template<size_t ChunkSize>
+class LatencyTrackingAllocator<BitmapAllocator<ChunkSize>>
+{
+public:
+	template<class... Args>
+	explicit LatencyTrackingAllocator( Args&&... arg_args );
+	inline void* Allocate();
+	inline void* TryAllocate();
+	inline void Free( void* arg_ptr );
+	inline LatencyHistogram AllocateLatency() const;
+	inline LatencyHistogram FreeLatency() const;
+	inline void ResetLatency();
+	inline BitmapAllocator<ChunkSize>& Pool();
+
+private:
+	detail::LatencyShards latency_;
+	BitmapAllocator<ChunkSize> pool_;
+};
+#endif // !HSA_NO_MALLOC
+#ifndef HSA_NO_MALLOC
+/**
+* @brief an allocation that was sampled by the HeapProfiler.
+*/
+struct HeapSample
+{
+	static const size_t max_frames = 32;
+
+	const void* ptr_;			// the sampled allocation. nullptr for an empty slot of the sample table.
+	size_t size_;				// requested size in bytes.
+	size_t weight_;				// estimated amount of allocated bytes this sample stands for.
+	size_t frame_count_;
+	void* frames_[max_frames];	// return addresses, the caller of Allocate() first.
+};
+/**
+* @brief callback used to visit the live samples of a HeapProfiler.
+* @param sample that is visited
+* @param user data passed to Walk()
+*/
+typedef void( *HeapSampleCallback )( const HeapSample& arg_sample, void* arg_user_data );
+/**
+* @brief samples allocations of any Allocator by size and keeps the call stacks of sampled allocations that are still alive.
+* @details every allocated byte has the same chance to be sampled. on average one sample is taken every sample interval bytes,
+* so big allocations are sampled more often than small ones and the cost does not depend on the amount of calls.
+* a sampled allocation stores its call stack in a table that is keyed by pointer. Free() removes it again.
+* Free() only looks at the table when there are live samples.
+* call stacks are captured with backtrace() on glibc and apple platforms and with RtlCaptureStackBackTrace on windows.
+* the profiler itself is not thread safe, like the allocators it wraps.
+* @code
+* FreeListAllocator pool( MIBI( 64 ) );
+* HeapProfiler profiler( &pool );
+* STLAllocatorWrapper<int> wrapper( &profiler );
+* std::vector<int, STLAllocatorWrapper<int>> numbers( wrapper );
+* ...
+* profiler.WriteFoldedStacks( buffer, buffer_size );
+* @endcode
+*/
+class HeapProfiler : public Allocator
+{
+public:
+	/**
+	* @brief Constructor
+	* @param allocator that is profiled. nullptr uses the AlignedMallocAllocator, so the alignment is kept.
+	* @param average amount of bytes between two samples. 0 samples every allocation. Default = 512 KiBi
+	*/
+	HeapProfiler( Allocator* arg_allocator, size_t arg_sample_interval = KIBI( 512 ) );
+	~HeapProfiler();
+	HeapProfiler( const HeapProfiler& ) = delete;
+	HeapProfiler& operator=( const HeapProfiler& ) = delete;
+
+	/**
+	* @brief allocates with the profiled allocator. never inlined, the call stack of a sample starts at its caller.
+	*/
+	HSA_NOINLINE virtual void* Allocate( size_t arg_size, size_t arg_alignment = 0 ) override;
+	HSA_NOINLINE virtual void* TryAllocate( size_t arg_size, size_t arg_alignment = 0 ) override;
+	virtual void Free( void* arg_ptr ) override;
+	/**
+	* @brief forwarded to the profiled allocator. a sample keeps the size it was taken with.
+	*/
+	virtual bool TryExpand( void* arg_ptr, size_t arg_size, size_t arg_new_size ) override;
+	/**
+	* @brief removes the sample like Free() and forwards to FreeSized() of the profiled allocator.
+	*/
+	virtual void FreeSized( void* arg_ptr, size_t arg_size ) override;
+	/**
+	* @brief changes the sample interval. samples that were taken keep their weight.
+	*/
+	void SetSampleInterval( size_t arg_sample_interval );
+	size_t SampleInterval() const;
+	size_t LiveSampleCount() const;
+	/**
+	* @brief estimate of the bytes that are allocated through the profiler and not freed yet.
+	*/
+	size_t EstimatedLiveBytes() const;
+	/**
+	* @brief visits every live sample.
+	* @attention the callback is not allowed to allocate or free memory with the profiler.
+	*/
+	void Walk( HeapSampleCallback arg_callback, void* arg_user_data = nullptr ) const;
+	/**
+	* @brief writes the live samples in folded stacks format, one line per call stack: "0x1234;0x5678 bytes".
+	* @details the outermost frame comes first, as expected by flame graph tools. identical call stacks are merged.
+	* frames are return addresses. tools like addr2line or atos turn them into function names.
+	* @param buffer for the text. the result is null terminated and cut off when the buffer is too small.
+	* @param size of the buffer in bytes
+	* @return amount of characters written without the null terminator.
+	*/
+	size_t WriteFoldedStacks( char* arg_buffer, size_t arg_buffer_size ) const;
+
+private:
+	bool SampleDue( size_t arg_size );
+	void Sample( void* arg_ptr, size_t arg_size, void* const* arg_frames, size_t arg_frame_count );
+	void RemoveSample( void* arg_ptr );
+	bool GrowTable();
+	size_t NextSampleDistance();
+	size_t SlotOf( const void* arg_ptr ) const;
+
+	Allocator* allocator_ = nullptr;
+	size_t sample_interval_ = 0;
+	int64_t bytes_until_sample_ = 0;
+	uint64_t random_state_ = 0;
+	HeapSample* samples_ = nullptr;	// open addressing table with linear probing.
+	size_t capacity_ = 0;			// power of two.
+	size_t sample_count_ = 0;
+	size_t sampled_bytes_ = 0;		// sum of the weights of the live samples.
+};
+#endif // !HSA_NO_MALLOC
+#ifndef HSA_NO_MALLOC
+namespace detail
+{
+	/**
+	* @brief address range of an allocator in the page map.
+	*/
+	struct PageMapRange
+	{
+		std::atomic<const char*> begin_;
+		std::atomic<const char*> end_;
+		std::atomic<Allocator*> owner_;
+		PageMapRange* next_free_;	// only used under the lock.
+	};
+	/**
+	* @brief list of the ranges on a page that is shared by more than one range, newest range first.
+	*/
+	struct PageMapNode
+	{
+		std::atomic<PageMapRange*> range_;
+		std::atomic<PageMapNode*> next_;
+	};
+}
+/**
+* @brief process wide radix tree that maps every 4 KiBi page to the allocator that owns it, like the page map of tcmalloc.
+* @details allocators register the address range of their pool. OwnerOf() finds the allocator of any pointer with four loads
+* and no lock. a page that is used by more than one range, at the edge of a small pool or inside a pool that was allocated from
+* another pool, keeps a short list of its ranges. the newest range is found first, so a nested pool wins over its parent.
+* define HSA_PAGE_MAP to let the linear, free list, stack, buddy, ring and pool allocator register themselves.
+* tree nodes are never freed, ranges and list nodes are reused. lookups do not take the lock. every Register() and Unregister()
+* bumps a version and a lookup that saw the version change is repeated, so it never returns a result read from a reused node.
+* addresses have to fit in 48 bits.
+* @code
+* void* ptr = some_allocator->Allocate( 64 );
+* ...
+* PageMap::Free( ptr );	// finds some_allocator
+* @endcode
+*/
+class PageMap
+{
+public:
+	static const size_t page_shift = 12;
+	static const size_t level_bits = 12;
+	static const size_t address_bits = 48;
+	/**
+	* @brief registers the pool of an allocator. ranges may be nested but may not overlap partially.
+	* @return false if a tree node could not be allocated.
+	*/
+	static bool Register( Allocator* arg_owner, void* arg_begin, size_t arg_size );
+	/**
+	* @brief removes a range that was registered with the same owner and begin.
+	*/
+	static void Unregister( Allocator* arg_owner, const void* arg_begin );
+	/**
+	* @brief the allocator whose pool contains the pointer.
+	* @return nullptr if the pointer is not in a registered pool.
+	*/
+	static inline Allocator* OwnerOf( const void* arg_ptr );
+	/**
+	* @brief checks in O(1) if the pointer is part of the pool of the allocator.
+	*/
+	static inline bool Owns( const Allocator* arg_allocator, const void* arg_ptr );
+	/**
+	* @brief frees memory with the allocator that owns it.
+	* @return false if no registered allocator owns the pointer.
+	*/
+	static inline bool Free( void* arg_ptr );
+};
+#endif // !HSA_NO_MALLOC
+/**
+* @brief dynamic array that allocates from an Allocator*, like std::vector.
+* @details when the buffer is full the vector first asks the allocator to grow it in place with TryExpand(). a vector that is the
+* last allocation of a linear or region allocator grows without copying and without leaving the old buffer behind.
+* otherwise the elements are moved to a buffer twice as big and the old buffer is given back with FreeSized().
+* @code
+* RegionAllocator request_region( KIBI( 64 ) );
+* Vector<int> ids( &request_region );
+* for( int i = 0; i < 1000; i++ )
+* {
+*	ids.PushBack( i );
+* }
+* @endcode
+*/
+template<class T>
+class Vector
+{
+public:
+	/**
+	* @brief Constructor
+	* @param allocator used for the buffer
+	* @param capacity to reserve. Default = 0
+	*/
+	explicit Vector( Allocator* arg_allocator, size_t arg_capacity = 0 );
+	Vector( const Vector& ) = delete;
+	Vector& operator=( const Vector& ) = delete;
+	/**
+	* @brief move constructor. the other vector is empty afterwards.
+	*/
+	Vector( Vector&& arg_other ) noexcept;
+	Vector& operator=( Vector&& arg_other ) noexcept;
+	/**
+	* @brief Destructor, destructs the elements and gives the buffer back to the allocator.
+	*/
+	~Vector();
+	/**
+	* @brief appends a copy of the value.
+	* @return false if the buffer could not grow.
+	*/
+	inline bool PushBack( const T& arg_value );
+	inline bool PushBack( T&& arg_value );
+	/**
+	* @brief constructs an element at the end.
+	* @param arguments passed to the constructor of T
+	* @return pointer to the new element. nullptr if the buffer could not grow.
+	*/
+	template<class... Args>
+	inline T* EmplaceBack( Args&&... arg_args );
+	/**
+	* @brief destructs the last element.
+	*/
+	inline void PopBack();
+	/**
+	* @brief makes room for at least arg_capacity elements.
+	* @return false if the buffer could not grow.
+	*/
+	inline bool Reserve( size_t arg_capacity );
+	/**
+	* @brief default constructs or destructs elements at the end until the vector has arg_size elements.
+	* @return false if the buffer could not grow.
+	*/
+	inline bool Resize( size_t arg_size );
+	/**
+	* @brief destructs all elements. keeps the buffer.
+	*/
+	inline void Clear();
+	inline T& operator[]( size_t arg_index );
+	inline const T& operator[]( size_t arg_index ) const;
+	inline T& Back();
+	inline T* Data();
+	inline const T* Data() const;
+	inline size_t Size() const;
+	inline size_t Capacity() const;
+	inline bool Empty() const;
+	inline T* begin();
+	inline T* end();
+	inline const T* begin() const;
+	inline const T* end() const;
+
+private:
+	inline bool Grow( size_t arg_min_capacity );
+	inline bool Reallocate( size_t arg_capacity );
+
+	Allocator* allocator_ = nullptr;
+	T* data_ = nullptr;
+	size_t size_ = 0;
+	size_t capacity_ = 0;
+};
+namespace detail
+{
+	// control byte of a FlatHashMap slot. full slots store the low 7 bits of the hash.
+	const int8_t flat_map_empty = -128;
+	const int8_t flat_map_deleted = -2;
+	const size_t flat_map_group_size = 16;
+}
+/**
+* @brief open addressing hash map that allocates from an Allocator*.
+* @details the map keeps one control byte per slot, like the swiss tables of abseil. slots are split in groups of 16. a lookup
+* compares the 7 bit hash tag of a whole group at once with SSE2, or byte by byte without SSE2 or when HSA_NO_SIMD is defined,
+* and only compares the keys of slots with a matching tag. the control bytes and the slots are one allocation, so the map
+* is dense and can live in a linear or region allocator. growing moves the slots to a table twice as big and frees the old
+* table with FreeSized(). on a linear allocator the old table stays allocated, Reserve() the expected size to avoid that.
+* @code
+* RegionAllocator request_region( KIBI( 64 ) );
+* FlatHashMap<uint64_t, uint32_t> index( &request_region, 256 );
+* index.Insert( 42, 7 );
+* uint32_t* row = index.Find( 42 );
+* @endcode
+*/
+template<class Key, class Value, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<Key>>
+class FlatHashMap
+{
+public:
+	/**
+	* @brief Constructor
+	* @param allocator used for the table
+	* @param amount of elements to reserve. Default = 0
+	*/
+	explicit FlatHashMap( Allocator* arg_allocator, size_t arg_count = 0 );
+	FlatHashMap( const FlatHashMap& ) = delete;
+	FlatHashMap& operator=( const FlatHashMap& ) = delete;
+	/**
+	* @brief move constructor. the other map is empty afterwards.
+	*/
+	FlatHashMap( FlatHashMap&& arg_other ) noexcept;
+	FlatHashMap& operator=( FlatHashMap&& arg_other ) noexcept;
+	/**
+	* @brief Destructor, destructs the elements and gives the table back to the allocator.
+	*/
+	~FlatHashMap();
+	/**
+	* @return pointer to the value of the key. nullptr if the key is not in the map.
+	*/
+	inline Value* Find( const Key& arg_key );
+	inline const Value* Find( const Key& arg_key ) const;
+	inline bool Contains( const Key& arg_key ) const;
+	/**
+	* @brief constructs the value of the key if the key is not in the map. an existing value is not changed.
+	* @param arguments passed to the constructor of Value
+	* @return pointer to the value of the key. nullptr if the table could not grow.
+	*/
+	template<class... Args>
+	inline Value* Emplace( const Key& arg_key, Args&&... arg_args );
+	/**
+	* @brief inserts the key or assigns the value if the key is already in the map.
+	* @return pointer to the value of the key. nullptr if the table could not grow.
+	*/
+	inline Value* Insert( const Key& arg_key, const Value& arg_value );
+	/**
+	* @brief value of the key. default constructs the value if the key is not in the map.
+	*/
+	inline Value& operator[]( const Key& arg_key );
+	/**
+	* @brief removes the key.
+	* @return false if the key was not in the map.
+	*/
+	inline bool Erase( const Key& arg_key );
+	/**
+	* @brief removes all elements. keeps the table.
+	*/
+	inline void Clear();
+	/**
+	* @brief makes room for at least arg_count elements.
+	* @return false if the table could not grow.
+	*/
+	inline bool Reserve( size_t arg_count );
+	/**
+	* @brief calls arg_function( const Key&, Value& ) for every element in table order.
+	* @attention the function should not insert or erase elements.
+	*/
+	template<class Function>
+	inline void ForEach( Function&& arg_function );
+	inline size_t Size() const;
+	/**
+	* @brief amount of slots. at most 7 / 8 of the slots are used.
+	*/
+	inline size_t Capacity() const;
+	inline bool Empty() const;
+
+private:
+	struct Slot
+	{
+		template<class... Args>
+		Slot( const Key& arg_key, Args&&... arg_args ) :
+			key_( arg_key ),
+			value_( std::forward<Args>( arg_args )... )
+		{
+		}
+		Key key_;
+		Value value_;
+	};
+	static inline uint64_t HashOf( const Key& arg_key );
+	template<class... Args>
+	inline Slot* FindOrInsert( const Key& arg_key, bool& arg_inserted, Args&&... arg_args );
+	inline size_t FindIndex( const Key& arg_key, uint64_t arg_hash ) const;
+	inline size_t FindInsertIndex( uint64_t arg_hash ) const;
+	inline bool Rehash( size_t arg_capacity );
+	inline void DestroySlots();
+	static inline size_t SlotOffset( size_t arg_capacity );
+
+	Allocator* allocator_ = nullptr;
+	int8_t* control_ = nullptr;	// Capacity() control bytes followed by the slots.
+	Slot* slots_ = nullptr;
+	size_t capacity_ = 0;		// 0 or a power of two of at least 16.
+	size_t size_ = 0;
+	size_t growth_left_ = 0;	// amount of empty slots that can be used before the table has to grow.
+};
+#endif // !HSA_INCLUDE_HEADER
+
+#ifdef HSA_IMPLEMENTATION
+#ifndef HSA_NO_MALLOC
+#include <cstdlib>
+#endif // HSA_NO_MALLOC
+#if _WIN64 && !__clang__
+#include <intrin.h>
+#endif
+#ifdef HSA_LATENCY_RDTSC
+#if _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif // HSA_LATENCY_RDTSC
+#include <utility>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#ifndef HSA_NO_MALLOC
+#if __GLIBC__ || __APPLE__
+#include <execinfo.h>
+#elif _WIN32
+extern "C" __declspec( dllimport ) unsigned short __stdcall RtlCaptureStackBackTrace( unsigned long, unsigned long, void**, unsigned long* );
+#endif
+#endif // !HSA_NO_MALLOC
+#ifdef HSA_POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <cerrno>
+#endif // HSA_POSIX
+
+#pragma region HelperFunctions
+namespace detail
+{
+	inline size_t calcAlignedOffset( size_t arg_to_align, size_t arg_alignment )
+	{
+		if( arg_alignment == 0 )
+		{
+			return 0;
+		}
+		size_t aligned_offset = arg_alignment - ( arg_to_align % arg_alignment );
+		return aligned_offset == arg_alignment ? 0 : aligned_offset;
+	}
+	/**
+	* @brief gives the pages that are completely inside [begin, end) back to the operating system.
+	* @return amount of released bytes that were resident.
+	*/
+	inline size_t releasePages( char* arg_begin, char* arg_end )
+	{
+#ifdef HSA_POSIX
+		static const size_t page_size = static_cast< size_t >( sysconf( _SC_PAGESIZE ) );
+		const size_t pages_per_batch = 256;
+		char* page_begin = arg_begin + calcAlignedOffset( reinterpret_cast< size_t >( arg_begin ), page_size );
+		char* page_end = arg_end - reinterpret_cast< size_t >( arg_end ) % page_size;
+		size_t released = 0;
+		while( page_begin < page_end )
+		{
+			size_t batch_size = static_cast< size_t >( page_end - page_begin );
+			if( batch_size > pages_per_batch * page_size )
+			{
+				batch_size = pages_per_batch * page_size;
+			}
+			// only count pages that are resident so repeated trimming does not report the same memory twice.
+#if __APPLE__
+			char residency[pages_per_batch];
+#else
+			unsigned char residency[pages_per_batch];
+#endif
+			if( mincore( page_begin, batch_size, residency ) == 0 )
+			{
+				for( size_t page = 0; page < batch_size / page_size; page++ )
+				{
+					released += ( residency[page] & 1 ) ? page_size : 0;
+				}
+				madvise( page_begin, batch_size, MADV_DONTNEED );
+			}
+			page_begin += batch_size;
+		}
+		return released;
+#else
+		HSA_UNUSED( arg_begin );
+		HSA_UNUSED( arg_end );
+		return 0;
+#endif // HSA_POSIX
+	}
+	/**
+	* @brief HeapWalkCallback that releases the pages of free blocks. user data is a TrimContext.
+	*/
+	struct TrimContext
+	{
+		char* mem_pool_;
+		size_t released_;
+	};
+	inline void trimBlock( const HeapBlock& arg_block, void* arg_context )
+	{
+		if( arg_block.is_free_ )
+		{
+			TrimContext* context = static_cast< TrimContext* >( arg_context );
+			char* block_ptr = context->mem_pool_ + arg_block.offset_;
+			context->released_ += releasePages( block_ptr + arg_block.padding_ + arg_block.header_size_, block_ptr + arg_block.size_ );
+		}
+	}
+	/**
+	* @brief index of the lowest set bit. arg_value cannot be 0.
+	*/
+	inline size_t countTrailingZeros( uint64_t arg_value )
+	{
+		HSA_ASSERT( arg_value != 0 );
+#if __GNUC__ || __clang__
+		return static_cast< size_t >( __builtin_ctzll( arg_value ) );
+#elif _WIN64
+		unsigned long index;
+		_BitScanForward64( &index, arg_value );
+		return index;
+#else
+		size_t index = 0;
+		while( ( arg_value & 1 ) == 0 )
+		{
+			arg_value >>= 1;
+			++index;
+		}
+		return index;
+#endif
+	}
+	inline size_t highestBit( uint64_t arg_value )
+	{
+		HSA_ASSERT( arg_value != 0 );
+#if __GNUC__ || __clang__
+		return static_cast< size_t >( 63 - __builtin_clzll( arg_value ) );
+#elif _WIN64
+		unsigned long index;
+		_BitScanReverse64( &index, arg_value );
+		return index;
+#else
+		size_t index = 0;
+		while( ( arg_value >>= 1 ) != 0 )
+		{
+			++index;
+		}
+		return index;
+#endif
+	}
+	/**
+	* @brief timestamp for latency measurements. nanoseconds, or cpu ticks when HSA_LATENCY_RDTSC is defined.
+	*/
+	inline uint64_t latencyTimestamp()
+	{
+#ifdef HSA_LATENCY_RDTSC
+		return __rdtsc();
+#else
+		return static_cast< uint64_t >( std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now().time_since_epoch() ).count() );
+#endif // HSA_LATENCY_RDTSC
+	}
+	/**
+	* @brief adds the result of snprintf to the amount of written characters of a text buffer.
+	* @details when snprintf cut off the text the amount stops at the null terminator, so the next snprintf writes nothing.
+	* @param result of snprintf
+	* @param size of the buffer in bytes
+	* @param amount of characters in the buffer without the null terminator
+	*/
+	inline void addWritten( int arg_result, size_t arg_buffer_size, size_t& arg_written )
+	{
+		if( arg_result > 0 )
+		{
+			arg_written += static_cast< size_t >( arg_result );
+		}
+		if( arg_written >= arg_buffer_size )
+		{
+			arg_written = arg_buffer_size - 1;
+		}
+	}
+	/**
+	* @brief registers the pool of an allocator in the PageMap when HSA_PAGE_MAP is defined.
+	*/
+	inline void pageMapRegister( Allocator* arg_owner, void* arg_begin, size_t arg_size )
+	{
+#if defined( HSA_PAGE_MAP ) && !defined( HSA_NO_MALLOC )
+		if( arg_begin != nullptr && arg_size != 0 )
+		{
+			bool registered = PageMap::Register( arg_owner, arg_begin, arg_size );
+			HSA_ASSERT( registered ) // page map is out of memory
+			HSA_UNUSED( registered );
+		}
+#else
+		HSA_UNUSED( arg_owner );
+		HSA_UNUSED( arg_begin );
+		HSA_UNUSED( arg_size );
+#endif
+	}
+	inline void pageMapUnregister( Allocator* arg_owner, const void* arg_begin, size_t arg_size )
+	{
+#if defined( HSA_PAGE_MAP ) && !defined( HSA_NO_MALLOC )
+		if( arg_begin != nullptr && arg_size != 0 )
+		{
+			PageMap::Unregister( arg_owner, arg_begin );
+		}
+#else
+		HSA_UNUSED( arg_owner );
+		HSA_UNUSED( arg_begin );
+		HSA_UNUSED( arg_size );
+#endif
+	}
+}
+#pragma endregion
+#pragma region MallocAllocatorImplementation
+#ifndef HSA_NO_MALLOC
+void* MallocAllocator::Allocate( size_t arg_size, size_t arg_alignment )
+{
+	HSA_UNUSED(arg_alignment);
+	return malloc( arg_size );
+}
+void MallocAllocator::Free( void* arg_ptr )
+{
+	free( arg_ptr );
+}
+
+void* AlignedMallocAllocator::Allocate( size_t arg_size, size_t arg_alignement )
+{
+	size_t alignment = arg_alignement > 16 ? arg_alignement : 16;
+	HSA_ASSERT( ( alignment & ( alignment - 1 ) ) == 0 ); // alignment has to be a power of two
+#if _WIN32
+	return _aligned_malloc( arg_size, alignment );
+#else
+	void* ret_ptr = nullptr;
+	if( posix_memalign( &ret_ptr, alignment, arg_size ) != 0 )
+	{
+		return nullptr;
+	}
+	return ret_ptr;
+#endif
+}
+void AlignedMallocAllocator::Free( void* arg_ptr )
+{
+#if _WIN32
+	_aligned_free( arg_ptr );
+#else
+	free( arg_ptr );
+#endif
+}
+#endif // HSA_NO_MALLOC
+#pragma endregion
+#pragma region LinearAllocatorImplementation
+LinearAllocator::LinearAllocator()
+{
+#ifndef HSA_NO_MALLOC
+	mem_pool_ = static_cast< char* >( malloc( pool_size_ = MIBI( 50 ) ) );
+#endif // !HSA_NO_MALLOC
+
+		HSA_ASSERT( mem_pool_ )
+	detail::pageMapRegister( this, mem_pool_, pool_size_ );
+}
+LinearAllocator::LinearAllocator( size_t arg_size, Allocator* arg_allocator ) :
+	allocator_( arg_allocator )
+{
+	if( arg_allocator )
+	{
+		mem_pool_ = static_cast< char* >( arg_allocator->Allocate( pool_size_ = arg_size, 16 ) );
+	}
+	else
+	{
+#ifndef HSA_NO_MALLOC
+		mem_pool_ = static_cast< char* >( malloc( pool_size_ = arg_size ) );
+#endif
+	}
+	HSA_ASSERT( mem_pool_ )
+	detail::pageMapRegister( this, mem_pool_, pool_size_ );
+}
+LinearAllocator::LinearAllocator( void* arg_buffer, size_t arg_size ) :
+	mem_pool_( static_cast< char* >( arg_buffer ) ),
+	pool_size_( arg_size ),
+	owns_pool_( false )
+{
+	HSA_ASSERT( mem_pool_ )
+	detail::pageMapRegister( this, mem_pool_, pool_size_ );
+}
+LinearAllocator::~LinearAllocator()
+{
+	if( page_mapped_ )
+	{
+		detail::pageMapUnregister( this, mem_pool_, pool_size_ );
+	}
+	if( !owns_pool_ )
+	{
+		return;
+	}
+	if( allocator_ )
+	{
+		allocator_->Free( mem_pool_ );
+	}
+	else
+	{
+#ifndef HSA_NO_MALLOC
+		free( mem_pool_ );
+#endif // !HSA_NO_MALLOC
+	}
+}
+inline void* LinearAllocator::Allocate( size_t arg_size, size_t arg_alignment )
+{
+	void* ret_ptr = TryAllocate( arg_size, arg_alignment );
+	HSA_ASSERT( ret_ptr != nullptr ) // out of memory
+	return ret_ptr;
+}
+inline void* LinearAllocator::TryAllocate( size_t arg_size, size_t arg_alignment )
+{
+	void* ret_ptr = nullptr;
+	size_t aligned_offset = detail::calcAlignedOffset( reinterpret_cast< size_t >( mem_pool_ ) + current_offset_, arg_alignment );
+
+	if( current_offset_ + aligned_offset + arg_size <= pool_size_ )
+	{
+		current_offset_ += aligned_offset;
+		ret_ptr = mem_pool_ + current_offset_;
+		current_offset_ += arg_size;
+	}
+	return ret_ptr;
+}
+inline bool LinearAllocator::Owns( const void* arg_ptr ) const
+{
+	return arg_ptr >= mem_pool_ && arg_ptr < mem_pool_ + pool_size_;
+}
+inline void LinearAllocator::Free( void* arg_ptr )
+{
+	HSA_UNUSED( arg_ptr );
+	HSA_ASSERT(false) //you cannot free memory with a linear allocator
+}
+inline bool LinearAllocator::TryExpand( void* arg_ptr, size_t arg_size, size_t arg_new_size )
+{
+	if( static_cast< char* >( arg_ptr ) + arg_size != mem_pool_ + current_offset_ || arg_new_size < arg_size )
+	{
+		return false;
+	}
+	if( arg_new_size - arg_size > pool_size_ - current_offset_ )
+	{
+		return false;
+	}
+	current_offset_ += arg_new_size - arg_size;
+	return true;
+}
+inline void LinearAllocator::FreeSized( void* arg_ptr, size_t arg_size )
+{
+	if( arg_ptr != nullptr && static_cast< char* >( arg_ptr ) + arg_size == mem_pool_ + current_offset_ )
+	{
+		current_offset_ -= arg_size;
+	}
+}
+inline void LinearAllocator::Reset()
+{
+	current_offset_ = 0;
+}
+#pragma endregion
+#pragma region RegionAllocatorImplementation
+RegionAllocator::RegionAllocator( size_t arg_chunk_size, Allocator* arg_allocator ) :
+	LinearAllocator( arg_chunk_size, arg_allocator ),
+	chunk_size_( arg_chunk_size )
+{
+	HSA_ASSERT( arg_chunk_size > sizeof( detail::RegionChunk ) );
+	owns_pool_ = false; // the chunks are freed by the region.
+	// chunks move between regions without touching them, a region is not kept in the PageMap.
+	detail::pageMapUnregister( this, mem_pool_, pool_size_ );
+	page_mapped_ = false;
+	used_head_ = used_tail_ = new( mem_pool_ ) detail::RegionChunk{ nullptr, arg_chunk_size };
+	current_offset_ = sizeof( detail::RegionChunk );
+}
+RegionAllocator::RegionAllocator( RegionAllocator& arg_parent ) :
+	LinearAllocator( arg_parent.AcquireChunk( arg_parent.chunk_size_ ), arg_parent.chunk_size_ ),
+	parent_( &arg_parent ),
+	chunk_size_( arg_parent.chunk_size_ )
+{
+	detail::pageMapUnregister( this, mem_pool_, pool_size_ );
+	page_mapped_ = false;
+	used_head_ = used_tail_ = reinterpret_cast< detail::RegionChunk* >( mem_pool_ );
+	used_head_->next_ = nullptr;
+	pool_size_ = used_head_->size_; // a cached chunk can be bigger than the chunk size.
+	current_offset_ = sizeof( detail::RegionChunk );
+	++parent_->child_count_;
+}
+RegionAllocator::~RegionAllocator()
+{
+	HSA_ASSERT( child_count_ == 0 ); // child regions have to be destroyed first
+	if( parent_ == nullptr )
+	{
+		DestroyChunks( used_head_ );
+		DestroyChunks( free_head_ );
+		return;
+	}
+	// used chunks followed by cached chunks go to the front of the parent cache.
+	detail::RegionChunk* tail = used_tail_;
+	if( free_head_ != nullptr )
+	{
+		tail->next_ = free_head_;
+		tail = free_tail_;
+	}
+	tail->next_ = parent_->free_head_;
+	if( parent_->free_head_ == nullptr )
+	{
+		parent_->free_tail_ = tail;
+	}
+	parent_->free_head_ = used_head_;
+	--parent_->child_count_;
+}
+inline void* RegionAllocator::Allocate( size_t arg_size, size_t arg_alignment )
+{
+	void* ret_ptr = TryAllocate( arg_size, arg_alignment );
+	HSA_ASSERT( ret_ptr != nullptr ) // out of memory
+	return ret_ptr;
+}
+inline void* RegionAllocator::TryAllocate( size_t arg_size, size_t arg_alignment )
+{
+	void* ret_ptr = LinearAllocator::TryAllocate( arg_size, arg_alignment );
+	if( ret_ptr != nullptr )
+	{
+		return ret_ptr;
+	}
+	return AllocateChunk( arg_size, arg_alignment );
+}
+inline bool RegionAllocator::Owns( const void* arg_ptr ) const
+{
+	for( const detail::RegionChunk* chunk = used_head_; chunk != nullptr; chunk = chunk->next_ )
+	{
+		const char* begin = reinterpret_cast< const char* >( chunk );
+		if( arg_ptr >= begin + sizeof( detail::RegionChunk ) && arg_ptr < begin + chunk->size_ )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+inline void RegionAllocator::Free( void* arg_ptr )
+{
+	HSA_UNUSED( arg_ptr );
+}
+inline void RegionAllocator::Reset()
+{
+	if( used_head_->next_ != nullptr )
+	{
+		used_tail_->next_ = free_head_;
+		if( free_head_ == nullptr )
+		{
+			free_tail_ = used_tail_;
+		}
+		free_head_ = used_head_->next_;
+		used_head_->next_ = nullptr;
+		used_tail_ = used_head_;
+	}
+	current_offset_ = sizeof( detail::RegionChunk );
+}
+void RegionAllocator::ReleaseCached()
+{
+	if( free_head_ == nullptr )
+	{
+		return;
+	}
+	if( parent_ == nullptr )
+	{
+		DestroyChunks( free_head_ );
+	}
+	else
+	{
+		free_tail_->next_ = parent_->free_head_;
+		if( parent_->free_head_ == nullptr )
+		{
+			parent_->free_tail_ = free_tail_;
+		}
+		parent_->free_head_ = free_head_;
+	}
+	free_head_ = free_tail_ = nullptr;
+}
+inline size_t RegionAllocator::ChunkSize() const
+{
+	return chunk_size_;
+}
+void* RegionAllocator::AllocateChunk( size_t arg_size, size_t arg_alignment )
+{
+	size_t min_size = sizeof( detail::RegionChunk ) + arg_size + ( arg_alignment > alignof( detail::RegionChunk ) ? arg_alignment : 0 );
+	detail::RegionChunk* chunk = AcquireChunk( min_size );
+	if( chunk == nullptr )
+	{
+		return nullptr;
+	}
+	char* begin = reinterpret_cast< char* >( chunk );
+	size_t offset = sizeof( detail::RegionChunk );
+	offset += detail::calcAlignedOffset( reinterpret_cast< size_t >( begin + offset ), arg_alignment );
+
+	if( min_size > chunk_size_ )
+	{
+		// an allocation that does not fit in a normal chunk gets its own chunk behind the newest one, which keeps its free space.
+		chunk->next_ = used_head_->next_;
+		used_head_->next_ = chunk;
+		if( used_tail_ == used_head_ )
+		{
+			used_tail_ = chunk;
+		}
+		return begin + offset;
+	}
+	chunk->next_ = used_head_;
+	used_head_ = chunk;
+	mem_pool_ = begin;
+	pool_size_ = chunk->size_;
+	current_offset_ = offset + arg_size;
+	return begin + offset;
+}
+detail::RegionChunk* RegionAllocator::AcquireChunk( size_t arg_min_size )
+{
+	if( free_head_ != nullptr && free_head_->size_ >= arg_min_size )
+	{
+		detail::RegionChunk* chunk = free_head_;
+		free_head_ = chunk->next_;
+		if( free_head_ == nullptr )
+		{
+			free_tail_ = nullptr;
+		}
+		return chunk;
+	}
+	if( parent_ != nullptr )
+	{
+		return parent_->AcquireChunk( arg_min_size );
+	}
+
+	size_t size = arg_min_size > chunk_size_ ? arg_min_size : chunk_size_;
+	void* memory = nullptr;
+	if( allocator_ )
+	{
+		memory = allocator_->TryAllocate( size, alignof( detail::RegionChunk ) );
+	}
+	else
+	{
+#ifndef HSA_NO_MALLOC
+		memory = malloc( size );
+#endif // !HSA_NO_MALLOC
+	}
+	if( memory == nullptr )
+	{
+		return nullptr;
+	}
+	return new( memory ) detail::RegionChunk{ nullptr, size };
+}
+void RegionAllocator::DestroyChunks( detail::RegionChunk* arg_chunk )
+{
+	while( arg_chunk != nullptr )
+	{
+		detail::RegionChunk* next = arg_chunk->next_;
+		if( allocator_ )
+		{
+			allocator_->Free( arg_chunk );
+		}
+		else
+		{
+#ifndef HSA_NO_MALLOC
+			free( arg_chunk );
+#endif // !HSA_NO_MALLOC
+		}
+		arg_chunk = next;
+	}
+}
+#pragma endregion
+#pragma region StackAllocatorImplementation
+StackAllocator::StackAllocator()
+{
+#ifndef HSA_NO_MALLOC
+	mem_pool_ = static_cast< char* >( malloc( pool_size_ = MIBI( 50 ) ) );
+#endif
+	HSA_ASSERT( mem_pool_ )
+	detail::pageMapRegister( this, mem_pool_, pool_size_ );
+}
+StackAllocator::StackAllocator( size_t arg_size, Allocator* arg_allocator ) :
+	allocator_( arg_allocator )
+{
+	if( arg_allocator )
+	{
+		mem_pool_ = static_cast< char* >( arg_allocator->Allocate( pool_size_ = arg_size, 16 ) );
+	}
+	else
+	{
+#ifndef HSA_NO_MALLOC
+		mem_pool_ = static_cast< char* >( malloc( pool_size_ = arg_size ) );
+#endif
+	}
+	HSA_ASSERT( mem_pool_ )
+	HSA_ASSERT( pool_size_ / detail::StackHeader::granularity < UINT32_MAX ) // pool too big for the header index
+	detail::pageMapRegister( this, mem_pool_, pool_size_ );
+}
+StackAllocator::StackAllocator( void* arg_buffer, size_t arg_size ) :
+	mem_pool_( static_cast< char* >( arg_buffer ) ),
+	pool_size_( arg_size ),
+	owns_pool_( false )
+{
+	HSA_ASSERT( mem_pool_ )
+	HSA_ASSERT( reinterpret_cast< size_t >( mem_pool_ ) % detail::StackHeader::granularity == 0 ) // buffer has to be aligned to 8 bytes
+	HSA_ASSERT( pool_size_ / detail::StackHeader::granularity < UINT32_MAX ) // pool too big for the header index
+	detail::pageMapRegister( this, mem_pool_, pool_size_ );
+}
+StackAllocator::~StackAllocator()
+{
+	detail::pageMapUnregister( this, mem_pool_, pool_size_ );
+	if( !owns_pool_ )
+	{
+		return;
+	}
+	if( allocator_ )
+	{
+		allocator_->Free( mem_pool_ );
+	}
+	else
+	{
+#ifndef HSA_NO_MALLOC
+		free( mem_pool_ );
+#endif // !HSA_NO_MALLOC
+	}
+}
+
+inline void* StackAllocator::Allocate( size_t arg_size, size_t arg_alignment )
+{
+	void* return_ptr = TryAllocate( arg_size, arg_alignment );
+	HSA_ASSERT( return_ptr != nullptr ) // out of memory
+	return return_ptr;
+}
+inline bool StackAllocator::Owns( const void* arg_ptr ) const
+{
+	return arg_ptr >= mem_pool_ && arg_ptr < mem_pool_ + pool_size_;
+}
+inline void* StackAllocator::TryAllocate( size_t arg_size, size_t arg_alignment )
+{
+	void* return_ptr = nullptr;
+	if( arg_alignment < detail::StackHeader::granularity )
+	{
+		arg_alignment = detail::StackHeader::granularity; // keeps the header at a multiple of 8 bytes.
+	}
+	size_t aligned_offset = detail::calcAlignedOffset( reinterpret_cast< size_t >( mem_pool_ ) + current_offset_ + sizeof( detail::StackHeader ), arg_alignment );
+
+	if( current_offset_ + aligned_offset + sizeof( detail::StackHeader ) + arg_size <= pool_size_ )
+	{
+		detail::StackHeader* header_ptr = reinterpret_cast< detail::StackHeader* >( mem_pool_ + current_offset_  + aligned_offset);
+		header_ptr->adjustment_flags_ = static_cast< uint32_t >( aligned_offset << 1 );
+		header_ptr->previous_index_ = IndexOf( last_allocated_header );
+		last_allocated_header = header_ptr;
+		return_ptr = mem_pool_ + current_offset_ + aligned_offset + sizeof( detail::StackHeader );
+		current_offset_ += arg_size + aligned_offset + sizeof( detail::StackHeader );
+	}
+
+	return return_ptr;
+}
+inline void StackAllocator::Free( void* arg_ptr )
+{
+	if( last_allocated_header == nullptr )
+	{
+		HSA_ASSERT( false ) //deallocation but never allocated
+	}
+	if( arg_ptr < mem_pool_ + sizeof( detail::StackHeader ) || arg_ptr > mem_pool_ + pool_size_ )
+	{
+		HSA_ASSERT( false ) //Deallocating outside of Allocator memory
+	}
+
+	char* arg_char_ptr = reinterpret_cast< char* >( arg_ptr );
+	detail::StackHeader* header_ptr = reinterpret_cast< detail::StackHeader* >( arg_char_ptr - sizeof( detail::StackHeader ) );
+	header_ptr->adjustment_flags_ |= 1u;
+	if( header_ptr == last_allocated_header )
+	{
+		detail::StackHeader* temp_header_ptr = header_ptr;
+		bool continue_looping = true;
+		do
+		{
+			detail::StackHeader* previous_header = PreviousOf( temp_header_ptr );
+			if( previous_header != nullptr )
+			{
+				if( previous_header->IsFree() )
+				{
+					temp_header_ptr = previous_header;
+				}
+				else
+				{
+					continue_looping = false;
+					char* temp_ptr = reinterpret_cast< char* >( temp_header_ptr );
+					current_offset_ = temp_ptr - temp_header_ptr->Adjustment() - mem_pool_;
+					last_allocated_header = previous_header;
+				}
+			}
+			else
+			{
+				continue_looping = false;
+				current_offset_ = 0;
+				last_allocated_header = nullptr;
+			}
+		} while( continue_looping );
+	}
+}
+inline void StackAllocator::Reset()
+{
+	current_offset_ = 0;
+	last_allocated_header = nullptr;
+}
+inline uint32_t StackAllocator::IndexOf( const detail::StackHeader* arg_header ) const
+{
+	if( arg_header == nullptr )
+	{
+		return 0;
+	}
+	return static_cast< uint32_t >( ( reinterpret_cast< const char* >( arg_header ) - mem_pool_ ) / detail::StackHeader::granularity + 1 );
+}
+inline detail::StackHeader* StackAllocator::PreviousOf( const detail::StackHeader* arg_header ) const
+{
+	if( arg_header->previous_index_ == 0 )
+	{
+		return nullptr;
+	}
+	return reinterpret_cast< detail::StackHeader* >( mem_pool_ + ( arg_header->previous_index_ - 1 ) * detail::StackHeader::granularity );
+}
+inline void StackAllocator::Walk( HeapWalkCallback arg_callback, void* arg_user_data )
+{
+	// headers only point to the previous header. reverse the list in place to walk in address order and restore it afterwards.
+	detail::StackHeader* first_header = nullptr;
+	detail::StackHeader* header_ptr = last_allocated_header;
+	while( header_ptr != nullptr )
+	{
+		detail::StackHeader* previous = PreviousOf( header_ptr );
+		header_ptr->previous_index_ = IndexOf( first_header );
+		first_header = header_ptr;
+		header_ptr = previous;
+	}
+
+	header_ptr = first_header;
+	while( header_ptr != nullptr )
+	{
+		detail::StackHeader* next = PreviousOf( header_ptr );
+		char* block_start = reinterpret_cast< char* >( header_ptr ) - header_ptr->Adjustment();
+		char* block_end = next != nullptr ? reinterpret_cast< char* >( next ) - next->Adjustment() : mem_pool_ + current_offset_;
+
+		HeapBlock block;
+		block.offset_ = block_start - mem_pool_;
+		block.size_ = block_end - block_start;
+		block.padding_ = header_ptr->Adjustment();
+		block.header_size_ = sizeof( detail::StackHeader );
+		block.is_free_ = header_ptr->IsFree();
+		arg_callback( block, arg_user_data );
+
+		header_ptr = next;
+	}
+
+	detail::StackHeader* previous = nullptr;
+	header_ptr = first_header;
+	while( header_ptr != nullptr )
+	{
+		detail::StackHeader* next = PreviousOf( header_ptr );
+		header_ptr->previous_index_ = IndexOf( previous );
+		previous = header_ptr;
+		header_ptr = next;
+	}
+
+	if( current_offset_ < pool_size_ )
+	{
+		HeapBlock block;
+		block.offset_ = current_offset_;
+		block.size_ = pool_size_ - current_offset_;
+		block.padding_ = 0;
+		block.header_size_ = 0;
+		block.is_free_ = true;
+		arg_callback( block, arg_user_data );
+	}
+}
+#pragma endregion
+#pragma region RingAllocatorImplementation
+namespace detail
+{
+	// a ring block header is the size of the block, a multiple of 8, with the flags in the low bits.
+	const uint64_t ring_block_free = 1;
+	// marks the word in front of an aligned allocation that holds the distance to the block header.
+	const uint64_t ring_padding_word = 2;
+	const uint64_t ring_flag_mask = 7;
+}
+RingAllocator::RingAllocator( size_t arg_size, Allocator* arg_allocator ) :
+	allocator_( arg_allocator ),
+	pool_size_( arg_size & ~size_t( 7 ) )
+{
+	if( arg_allocator )
+	{
+		mem_pool_ = static_cast< char* >( arg_allocator->Allocate( pool_size_, 16 ) );
+	}
+	else
+	{
+#ifndef HSA_NO_MALLOC
+		mem_pool_ = static_cast< char* >( malloc( pool_size_ ) );
+#endif // !HSA_NO_MALLOC
+	}
+	HSA_ASSERT( mem_pool_ );
+	detail::pageMapRegister( this, mem_pool_, pool_size_ );
+}
+RingAllocator::~RingAllocator()
+{
+	detail::pageMapUnregister( this, mem_pool_, pool_size_ );
+	if( allocator_ )
+	{
+		allocator_->Free( mem_pool_ );
+	}
+	else
+	{
+#ifndef HSA_NO_MALLOC
+		free( mem_pool_ );
+#endif // !HSA_NO_MALLOC
+	}
+}
+inline void* RingAllocator::Allocate( size_t arg_size, size_t arg_alignment )
+{
+	void* ret_ptr = TryAllocate( arg_size, arg_alignment );
+	HSA_ASSERT( ret_ptr != nullptr ) // out of memory
+	return ret_ptr;
+}
+inline void* RingAllocator::TryAllocate( size_t arg_size, size_t arg_alignment )
+{
+	size_t alignment = arg_alignment > 8 ? arg_alignment : 8;
+	// released_ is written after tail_, so the tail is at least as new as the released bytes.
+	uint64_t allocated = allocated_.load( std::memory_order_relaxed );
+	uint64_t used = allocated - released_.load( std::memory_order_acquire );
+	size_t tail = tail_.load( std::memory_order_acquire );
+	size_t head = head_;
+	if( head == pool_size_ )
+	{
+		head = 0; // the last block ended at the end of the pool. wraps like the tail in Free().
+	}
+
+	auto blockEnd = [&]( size_t arg_start, size_t& arg_payload )
+	{
+		arg_payload = arg_start + sizeof( uint64_t );
+		arg_payload += detail::calcAlignedOffset( reinterpret_cast< size_t >( mem_pool_ ) + arg_payload, alignment );
+		return ( arg_payload + arg_size + 7 ) & ~size_t( 7 );
+	};
+
+	size_t payload = 0;
+	size_t end = blockEnd( head, payload );
+	if( head < tail || ( head == tail && used != 0 ) )
+	{
+		// the free space is between the head and the tail.
+		if( end > tail )
+		{
+			return nullptr;
+		}
+	}
+	else if( end > pool_size_ )
+	{
+		// the free space is behind the head and in front of the tail. skip the end of the pool.
+		size_t start_payload = 0;
+		size_t start_end = blockEnd( 0, start_payload );
+		if( start_end > tail )
+		{
+			return nullptr;
+		}
+		*reinterpret_cast< uint64_t* >( mem_pool_ + head ) = ( pool_size_ - head ) | detail::ring_block_free;
+		allocated += pool_size_ - head;
+		head = 0;
+		payload = start_payload;
+		end = start_end;
+	}
+
+	*reinterpret_cast< uint64_t* >( mem_pool_ + head ) = end - head;
+	if( payload - head > sizeof( uint64_t ) )
+	{
+		*reinterpret_cast< uint64_t* >( mem_pool_ + payload - sizeof( uint64_t ) ) = ( payload - head ) | detail::ring_padding_word;
+	}
+	head_ = end;
+	allocated_.store( allocated + ( end - head ), std::memory_order_release ); // publishes the headers to the consumer.
+	return mem_pool_ + payload;
+}
+inline void RingAllocator::Free( void* arg_ptr )
+{
+	if( arg_ptr == nullptr )
+	{
+		return;
+	}
+	HSA_ASSERT( Owns( arg_ptr ) ); // memory was not allocated by this allocator
+	char* ptr = static_cast< char* >( arg_ptr );
+	uint64_t word = *reinterpret_cast< uint64_t* >( ptr - sizeof( uint64_t ) );
+	uint64_t* header = reinterpret_cast< uint64_t* >( ptr - sizeof( uint64_t ) );
+	if( ( word & detail::ring_padding_word ) != 0 )
+	{
+		header = reinterpret_cast< uint64_t* >( ptr - ( word & ~detail::ring_flag_mask ) );
+	}
+	HSA_ASSERT( ( *header & detail::ring_block_free ) == 0 ); // freed twice
+	*header |= detail::ring_block_free;
+
+	// move the tail over every free block. blocks behind a used block wait until it is freed.
+	uint64_t allocated = allocated_.load( std::memory_order_acquire );
+	uint64_t released = released_.load( std::memory_order_relaxed );
+	size_t tail = tail_.load( std::memory_order_relaxed );
+	while( released < allocated )
+	{
+		uint64_t tail_word = *reinterpret_cast< uint64_t* >( mem_pool_ + tail );
+		if( ( tail_word & detail::ring_block_free ) == 0 )
+		{
+			break;
+		}
+		size_t size = static_cast< size_t >( tail_word & ~detail::ring_flag_mask );
+		released += size;
+		tail += size;
+		if( tail == pool_size_ )
+		{
+			tail = 0;
+		}
+	}
+	tail_.store( tail, std::memory_order_release );
+	released_.store( released, std::memory_order_release );
+}
+inline bool RingAllocator::Owns( const void* arg_ptr ) const
+{
+	return arg_ptr >= mem_pool_ && arg_ptr < mem_pool_ + pool_size_;
+}
+inline void RingAllocator::Reset()
+{
+	head_ = 0;
+	allocated_.store( 0, std::memory_order_relaxed );
+	tail_.store( 0, std::memory_order_relaxed );
+	released_.store( 0, std::memory_order_relaxed );
+}
+inline size_t RingAllocator::UsedSize() const
+{
+	uint64_t released = released_.load( std::memory_order_acquire );
+	return static_cast< size_t >( allocated_.load( std::memory_order_acquire ) - released );
+}
+#pragma endregion
+#pragma region BitmapAllocatorImplementation
+template <size_t ChunkSize>
+BitmapAllocator<ChunkSize>::BitmapAllocator()
+{
+#ifndef HSA_NO_MALLOC
+	bitmap_ = static_cast< unsigned char* >( malloc( 64 * sizeof( char ) ) ); //allocate bitmap
+	mem_pool_ = static_cast< detail::bitmapChunk<ChunkSize>* >( malloc( 512 * ChunkSize ) );
+#endif
+	HSA_ASSERT( mem_pool_ )
+	chunk_size_ = ChunkSize;
+	chunk_count_ = 512;
+}
+template <size_t ChunkSize>
+BitmapAllocator<ChunkSize>::BitmapAllocator( size_t arg_chunk_count, Allocator* arg_allocator ) :
+	allocator_( arg_allocator )
+{
+	size_t corrected_count = arg_chunk_count + detail::calcAlignedOffset( arg_chunk_count, 8 );
+	chunk_size_ = ChunkSize;
+	chunk_count_ = corrected_count;
+	if( arg_allocator )
+	{
+		bitmap_ = static_cast< unsigned char* >( arg_allocator->Allocate( ( corrected_count / 8 ) * sizeof( char ) ) );
+		mem_pool_ = static_cast< detail::bitmapChunk<ChunkSize>* >( arg_allocator->Allocate( corrected_count * sizeof( detail::bitmapChunk<ChunkSize> ) ) );
+	}
+	else
+	{
+#ifndef HSA_NO_MALLOC
+		bitmap_ = static_cast< unsigned char* >( malloc( ( corrected_count / 8 ) * sizeof( char ) ) );
+		mem_pool_ = static_cast< detail::bitmapChunk<ChunkSize>* >( malloc( corrected_count * sizeof( detail::bitmapChunk<ChunkSize> ) ) );
+#endif
+
+	}
+	HSA_ASSERT( mem_pool_ )
+}
+template <size_t ChunkSize>
+BitmapAllocator<ChunkSize>::BitmapAllocator( void* arg_chunk_buffer, unsigned char* arg_bitmap_buffer, size_t arg_chunk_count ) :
+	chunk_size_( ChunkSize ),
+	chunk_count_( arg_chunk_count ),
+	mem_pool_( static_cast< detail::bitmapChunk<ChunkSize>* >( arg_chunk_buffer ) ),
+	bitmap_( arg_bitmap_buffer ),
+	owns_pool_( false )
+{
+	HSA_ASSERT( mem_pool_ && bitmap_ && arg_chunk_count % 8 == 0 )
+}
+template <size_t ChunkSize>
+BitmapAllocator<ChunkSize>::~BitmapAllocator()
+{
+	if( allocator_ )
+	{
+		if( owns_pool_ )
+		{
+			allocator_->Free( mem_pool_ );
+			allocator_->Free( bitmap_ );
+		}
+		if( generations_ )
+		{
+			allocator_->Free( generations_ );
+		}
+	}
+	else
+	{
+#ifndef HSA_NO_MALLOC
+		if( owns_pool_ )
+		{
+			free( mem_pool_ );
+			free( bitmap_ );
+		}
+		free( generations_ );
+#endif // !HSA_NO_MALLOC
+	}
+}
+template <size_t ChunkSize>
+inline void* BitmapAllocator<ChunkSize>::Allocate()
+{
+	void* return_ptr = TryAllocate();
+	HSA_ASSERT( return_ptr != nullptr ) // out of memory
+	return return_ptr;
+}
+template <size_t ChunkSize>
+inline bool BitmapAllocator<ChunkSize>::Owns( const void* arg_ptr ) const
+{
+	return arg_ptr >= mem_pool_ && arg_ptr < mem_pool_ + chunk_count_;
+}
+template <size_t ChunkSize>
+inline void* BitmapAllocator<ChunkSize>::TryAllocate()
+{
+	void* return_ptr = nullptr;
+	size_t chunk_to_check = last_allocate_chunk + 1;
+	if( chunk_to_check >= chunk_count_ )
+	{
+		chunk_to_check = 0;
+	}
+	size_t startng_chunk = chunk_to_check;
+	bool chunk_allocated = false;
+	do
+	{
+		size_t bit_pos = ( chunk_to_check ) % 8;
+		size_t byte_pos = ( chunk_to_check ) / 8;
+
+		unsigned char bit_result = ( ( BitmapByte( byte_pos ) >> bit_pos ) & 0b00000001 );
+		if( !bit_result )
+		{
+			return_ptr = mem_pool_ + chunk_to_check; // getting allocation address
+			MarkUsed( chunk_to_check );
+			last_allocate_chunk = chunk_to_check;
+			chunk_allocated = true;
+		}
+		else
+		{
+			chunk_to_check++;
+			if( chunk_to_check >= chunk_count_ )
+			{
+				chunk_to_check = 0;
+			}
+			if( startng_chunk == chunk_to_check )
+			{
+				break; // all chunks are used.
+			}
+		}
+	} while( !chunk_allocated );
+
+	return return_ptr;
+}
+template <size_t ChunkSize>
+inline void BitmapAllocator<ChunkSize>::Free( void* arg_ptr )
+{
+	detail::bitmapChunk<ChunkSize>* bm_ptr = reinterpret_cast< detail::bitmapChunk<ChunkSize>* >( arg_ptr );
+	size_t index = bm_ptr - mem_pool_;
+	size_t bit_pos = ( index ) % 8;
+	size_t byte_pos = ( index ) / 8;
+	HSA_ASSERT( byte_pos < dirty_bytes_ ) // chunk was never allocated
+	bitmap_[byte_pos] &= ~( 0b00000001 << bit_pos );
+	if( trim_threshold_ != 0 )
+	{
+		freed_since_trim_ += sizeof( detail::bitmapChunk<ChunkSize> );
+		if( freed_since_trim_ >= trim_threshold_ )
+		{
+			Trim();
+		}
+	}
+}
+template <size_t ChunkSize>
+inline void BitmapAllocator<ChunkSize>::Reset()
+{
+	// handles to live chunks become stale because their chunks are no longer marked as used.
+	dirty_bytes_ = 0;
+	last_allocate_chunk = -1;
+}
+template <size_t ChunkSize>
+inline unsigned char BitmapAllocator<ChunkSize>::BitmapByte( size_t arg_byte_pos ) const
+{
+	return arg_byte_pos < dirty_bytes_ ? bitmap_[arg_byte_pos] : 0b00000000;
+}
+template <size_t ChunkSize>
+inline void BitmapAllocator<ChunkSize>::MarkUsed( size_t arg_index )
+{
+	size_t byte_pos = arg_index / 8;
+	while( dirty_bytes_ <= byte_pos )
+	{
+		bitmap_[dirty_bytes_++] = 0b00000000; // clear bytes of a previous Reset() when they are used again.
+	}
+	bitmap_[byte_pos] |= 0b00000001 << ( arg_index % 8 );
+	if( generations_ )
+	{
+		NextGeneration( arg_index ); // handles to a previous allocation of this chunk become stale.
+	}
+}
+template <size_t ChunkSize>
+inline PoolHandle BitmapAllocator<ChunkSize>::AllocateHandle()
+{
+	return HandleOf( Allocate() );
+}
+template <size_t ChunkSize>
+inline void BitmapAllocator<ChunkSize>::Free( PoolHandle arg_handle )
+{
+	void* chunk_ptr = Resolve( arg_handle );
+	HSA_ASSERT( chunk_ptr != nullptr ) // freeing a stale handle
+	if( chunk_ptr != nullptr )
+	{
+		Free( chunk_ptr );
+	}
+}
+template <size_t ChunkSize>
+inline void* BitmapAllocator<ChunkSize>::Resolve( PoolHandle arg_handle ) const
+{
+	size_t index = arg_handle.Index();
+	if( generations_ == nullptr || index >= chunk_count_ || generations_[index] != arg_handle.Generation() )
+	{
+		return nullptr;
+	}
+	if( ( ( BitmapByte( index / 8 ) >> ( index % 8 ) ) & 0b00000001 ) == 0 )
+	{
+		return nullptr; // chunk is freed
+	}
+	return mem_pool_ + index;
+}
+template <size_t ChunkSize>
+inline PoolHandle BitmapAllocator<ChunkSize>::HandleOf( void* arg_ptr )
+{
+	if( arg_ptr == nullptr )
+	{
+		return PoolHandle();
+	}
+	if( generations_ == nullptr )
+	{
+		InitGenerations();
+	}
+	size_t index = reinterpret_cast< detail::bitmapChunk<ChunkSize>* >( arg_ptr ) - mem_pool_;
+	HSA_ASSERT( index < chunk_count_ ); // pointer is not part of the allocator
+	return PoolHandle( index, generations_[index] );
+}
+template <size_t ChunkSize>
+inline void BitmapAllocator<ChunkSize>::InitGenerations()
+{
+	HSA_ASSERT( chunk_count_ <= PoolHandle::max_index + 1 ); // too many chunks for a handle
+	if( allocator_ )
+	{
+		generations_ = static_cast< uint16_t* >( allocator_->Allocate( chunk_count_ * sizeof( uint16_t ), alignof( uint16_t ) ) );
+	}
+	else
+	{
+#ifndef HSA_NO_MALLOC
+		generations_ = static_cast< uint16_t* >( malloc( chunk_count_ * sizeof( uint16_t ) ) );
+#endif // !HSA_NO_MALLOC
+	}
+	HSA_ASSERT( generations_ )
+	for( size_t i = 0; i < chunk_count_; i++ )
+	{
+		generations_[i] = 1;
+	}
+}
+template <size_t ChunkSize>
+inline void BitmapAllocator<ChunkSize>::NextGeneration( size_t arg_index )
+{
+	uint16_t generation = generations_[arg_index] + 1;
+	generations_[arg_index] = generation > PoolHandle::max_generation ? 1 : generation;
+}
+template <size_t ChunkSize>
+inline size_t BitmapAllocator<ChunkSize>::Trim()
+{
+	detail::TrimContext context = { reinterpret_cast< char* >( mem_pool_ ), 0 };
+	Walk( detail::trimBlock, &context );
+	freed_since_trim_ = 0;
+	return context.released_;
+}
+template <size_t ChunkSize>
+inline void BitmapAllocator<ChunkSize>::SetTrimThreshold( size_t arg_threshold )
+{
+	trim_threshold_ = arg_threshold;
+}
+template <size_t ChunkSize>
+inline void BitmapAllocator<ChunkSize>::Walk( HeapWalkCallback arg_callback, void* arg_user_data ) const
+{
+	if( chunk_count_ == 0 )
+	{
+		return; // an empty pool has no bitmap to read.
+	}
+	size_t run_start = 0;
+	bool run_is_free = ( BitmapByte( 0 ) & 0b00000001 ) == 0;
+	for( size_t chunk = 1; chunk <= chunk_count_; chunk++ )
+	{
+		bool is_free = true;
+		if( chunk < chunk_count_ )
+		{
+			size_t byte_pos = chunk / 8;
+			if( chunk % 8 == 0 && chunk + 8 <= chunk_count_ && BitmapByte( byte_pos ) == ( run_is_free ? 0b00000000 : 0b11111111 ) )
+			{
+				chunk += 7; // whole byte belongs to the current run.
+				continue;
+			}
+			is_free = ( ( BitmapByte( byte_pos ) >> ( chunk % 8 ) ) & 0b00000001 ) == 0;
+		}
+		if( chunk == chunk_count_ || is_free != run_is_free )
+		{
+			HeapBlock block;
+			block.offset_ = run_start * sizeof( detail::bitmapChunk<ChunkSize> );
+			block.size_ = ( chunk - run_start ) * sizeof( detail::bitmapChunk<ChunkSize> );
+			block.padding_ = 0;
+			block.header_size_ = 0;
+			block.is_free_ = run_is_free;
+			arg_callback( block, arg_user_data );
+
+			run_start = chunk;
+			run_is_free = is_free;
+		}
+	}
+}
+#pragma endregion
+#pragma region PoolAllocatorImplementation
+PoolAllocator::PoolAllocator( size_t arg_chunk_size, size_t arg_chunk_count, Allocator* arg_allocator ) :
+	allocator_( arg_allocator ),
+	chunk_size_( ( ( arg_chunk_size > sizeof( void* ) ? arg_chunk_size : sizeof( void* ) ) + sizeof( void* ) - 1 ) / sizeof( void* ) * sizeof( void* ) ),
+	chunk_count_( arg_chunk_count )
+{
+	if( arg_allocator )
+	{
+		mem_pool_ = static_cast< char* >( arg_allocator->Allocate( chunk_size_ * chunk_count_, 16 ) );
+	}
+	else
+	{
+#ifndef HSA_NO_MALLOC
+		mem_pool_ = static_cast< char* >( malloc( chunk_size_ * chunk_count_ ) );
+#endif // !HSA_NO_MALLOC
+	}
+	HSA_ASSERT( mem_pool_ );
+	detail::pageMapRegister( this, mem_pool_, chunk_size_ * chunk_count_ );
+}
+PoolAllocator::PoolAllocator( void* arg_buffer, size_t arg_chunk_size, size_t arg_chunk_count ) :
+	mem_pool_( static_cast< char* >( arg_buffer ) ),
+	chunk_size_( ( ( arg_chunk_size > sizeof( void* ) ? arg_chunk_size : sizeof( void* ) ) + sizeof( void* ) - 1 ) / sizeof( void* ) * sizeof( void* ) ),
+	chunk_count_( arg_chunk_count ),
+	owns_pool_( false )
+{
+	HSA_ASSERT( mem_pool_ );
+	HSA_ASSERT( reinterpret_cast< size_t >( mem_pool_ ) % sizeof( void* ) == 0 ); // the free list links need pointer alignment
+	detail::pageMapRegister( this, mem_pool_, chunk_size_ * chunk_count_ );
+}
+PoolAllocator::~PoolAllocator()
+{
+	detail::pageMapUnregister( this, mem_pool_, chunk_size_ * chunk_count_ );
+	if( !owns_pool_ )
+	{
+		return;
+	}
+	if( allocator_ )
+	{
+		allocator_->Free( mem_pool_ );
+	}
+	else
+	{
+#ifndef HSA_NO_MALLOC
+		free( mem_pool_ );
+#endif // !HSA_NO_MALLOC
+	}
+}
+inline void* PoolAllocator::Allocate()
+{
+	void* ret_ptr = TryAllocate();
+	HSA_ASSERT( ret_ptr != nullptr ) // out of memory
+	return ret_ptr;
+}
+inline void* PoolAllocator::TryAllocate()
+{
+	return TryAllocateChunk( chunk_size_ );
+}
+inline void* PoolAllocator::Allocate( size_t arg_size, size_t arg_alignment )
+{
+	void* ret_ptr = TryAllocate( arg_size, arg_alignment );
+	HSA_ASSERT( ret_ptr != nullptr ) // out of memory
+	return ret_ptr;
+}
+inline void* PoolAllocator::TryAllocate( size_t arg_size, size_t arg_alignment )
+{
+	return TryAllocateChunk( arg_size, arg_alignment, chunk_size_ );
+}
+inline void PoolAllocator::Free( void* arg_ptr )
+{
+	FreeChunk( arg_ptr, chunk_size_ );
+}
+inline bool PoolAllocator::Owns( const void* arg_ptr ) const
+{
+	return OwnsChunk( arg_ptr, chunk_size_ );
+}
+inline void PoolAllocator::Reset()
+{
+	free_list_ = nullptr;
+	unused_offset_ = 0;
+}
+inline size_t PoolAllocator::ChunkSize() const
+{
+	return chunk_size_;
+}
+inline size_t PoolAllocator::ChunkCount() const
+{
+	return chunk_count_;
+}
+inline void* PoolAllocator::TryAllocateChunk( size_t arg_chunk_size )
+{
+	void* ret_ptr = free_list_;
+	if( ret_ptr != nullptr )
+	{
+		free_list_ = *static_cast< void** >( ret_ptr );
+		return ret_ptr;
+	}
+	if( unused_offset_ < arg_chunk_size * chunk_count_ )
+	{
+		ret_ptr = mem_pool_ + unused_offset_;
+		unused_offset_ += arg_chunk_size;
+	}
+	return ret_ptr;
+}
+inline void* PoolAllocator::TryAllocateChunk( size_t arg_size, size_t arg_alignment, size_t arg_chunk_size )
+{
+	HSA_ASSERT( arg_size <= arg_chunk_size ); // does not fit in a chunk
+	HSA_UNUSED( arg_size );
+	if( arg_alignment != 0 && ( arg_chunk_size % arg_alignment != 0 || reinterpret_cast< size_t >( mem_pool_ ) % arg_alignment != 0 ) )
+	{
+		HSA_ASSERT( false ) // chunks are not aligned to the alignment
+		return nullptr;
+	}
+	return TryAllocateChunk( arg_chunk_size );
+}
+inline void PoolAllocator::FreeChunk( void* arg_ptr, size_t arg_chunk_size )
+{
+	if( arg_ptr == nullptr )
+	{
+		return;
+	}
+	HSA_ASSERT( OwnsChunk( arg_ptr, arg_chunk_size ) ); // memory was not allocated by this allocator
+	HSA_ASSERT( ( static_cast< char* >( arg_ptr ) - mem_pool_ ) % arg_chunk_size == 0 ); // pointer is not the start of a chunk
+	*static_cast< void** >( arg_ptr ) = free_list_;
+	free_list_ = arg_ptr;
+}
+inline bool PoolAllocator::OwnsChunk( const void* arg_ptr, size_t arg_chunk_size ) const
+{
+	return arg_ptr >= mem_pool_ && arg_ptr < mem_pool_ + arg_chunk_size * chunk_count_;
+}
+template<size_t ChunkBytes>
+inline void* FixedPoolAllocator<ChunkBytes>::Allocate()
+{
+	void* ret_ptr = TryAllocate();
+	HSA_ASSERT( ret_ptr != nullptr ) // out of memory
+	return ret_ptr;
+}
+template<size_t ChunkBytes>
+inline void* FixedPoolAllocator<ChunkBytes>::TryAllocate()
+{
+	return TryAllocateChunk( chunk_size );
+}
+template<size_t ChunkBytes>
+inline void* FixedPoolAllocator<ChunkBytes>::TryAllocate( size_t arg_size, size_t arg_alignment )
+{
+	return TryAllocateChunk( arg_size, arg_alignment, chunk_size );
+}
+template<size_t ChunkBytes>
+inline void FixedPoolAllocator<ChunkBytes>::Free( void* arg_ptr )
+{
+	FreeChunk( arg_ptr, chunk_size );
+}
+template<size_t ChunkBytes>
+inline bool FixedPoolAllocator<ChunkBytes>::Owns( const void* arg_ptr ) const
+{
+	return OwnsChunk( arg_ptr, chunk_size );
+}
+#pragma endregion
+#pragma region TypedPoolImplementation
+template <class T>
+TypedPool<T>::TypedPool( size_t arg_capacity, Allocator* arg_allocator ) :
+	allocator_( arg_allocator )
+{
+	word_count_ = ( arg_capacity + bits_per_word - 1 ) / bits_per_word;
+	capacity_ = word_count_ * bits_per_word;
+	if( arg_allocator )
+	{
+		bitmap_ = static_cast< uint64_t* >( arg_allocator->Allocate( word_count_ * sizeof( uint64_t ), alignof( uint64_t ) ) );
+		objects_ = static_cast< T* >( arg_allocator->Allocate( capacity_ * sizeof( T ), alignof( T ) ) );
+	}
+	else
+	{
+#ifndef HSA_NO_MALLOC
+		bitmap_ = static_cast< uint64_t* >( malloc( word_count_ * sizeof( uint64_t ) ) );
+		objects_ = static_cast< T* >( AlignedMallocAllocator().Allocate( capacity_ * sizeof( T ), alignof( T ) ) ); // malloc ignores over-aligned types.
+#endif // !HSA_NO_MALLOC
+	}
+	HSA_ASSERT( bitmap_ && objects_ )
+	for( size_t i = 0; i < word_count_; i++ )
+	{
+		bitmap_[i] = 0;
+	}
+}
+template <class T>
+TypedPool<T>::~TypedPool()
+{
+	Clear();
+	if( allocator_ )
+	{
+		allocator_->Free( objects_ );
+		allocator_->Free( bitmap_ );
+	}
+	else
+	{
+#ifndef HSA_NO_MALLOC
+		AlignedMallocAllocator().Free( objects_ );
+		free( bitmap_ );
+#endif // !HSA_NO_MALLOC
+	}
+}
+template <class T>
+template<class... Args>
+inline T* TypedPool<T>::Create( Args&&... arg_args )
+{
+	for( size_t word = search_word_; word < word_count_; word++ )
+	{
+		if( bitmap_[word] != ~uint64_t( 0 ) )
+		{
+			size_t bit = detail::countTrailingZeros( ~bitmap_[word] );
+			bitmap_[word] |= uint64_t( 1 ) << bit;
+			search_word_ = word;
+			++live_count_;
+			return new( objects_ + word * bits_per_word + bit ) T( std::forward<Args>( arg_args )... );
+		}
+	}
+	search_word_ = word_count_;
+	HSA_ASSERT( false ) // out of memory
+	return nullptr;
+}
+template <class T>
+inline void TypedPool<T>::Destroy( T* arg_ptr )
+{
+	size_t index = IndexOf( arg_ptr );
+	size_t word = index / bits_per_word;
+	uint64_t bit = uint64_t( 1 ) << ( index % bits_per_word );
+	HSA_ASSERT( ( bitmap_[word] & bit ) != 0 ); // object is not alive
+	arg_ptr->~T();
+	bitmap_[word] &= ~bit;
+	--live_count_;
+	if( word < search_word_ )
+	{
+		search_word_ = word;
+	}
+}
+template <class T>
+inline void TypedPool<T>::Clear()
+{
+	ForEach( [this]( T& arg_object ) { Destroy( &arg_object ); } );
+	search_word_ = 0;
+}
+template <class T>
+template<class Function>
+inline void TypedPool<T>::ForEach( Function&& arg_function )
+{
+	ForEach( 0, capacity_, std::forward<Function>( arg_function ) );
+}
+template <class T>
+template<class Function>
+inline void TypedPool<T>::ForEach( size_t arg_first, size_t arg_last, Function&& arg_function )
+{
+	HSA_ASSERT( arg_first <= arg_last && arg_last <= capacity_ );
+	if( arg_first == arg_last )
+	{
+		return;
+	}
+	size_t first_word = arg_first / bits_per_word;
+	size_t last_word = ( arg_last - 1 ) / bits_per_word;
+	for( size_t word = first_word; word <= last_word; word++ )
+	{
+		uint64_t bits = bitmap_[word];
+		if( word == first_word )
+		{
+			bits &= ~uint64_t( 0 ) << ( arg_first % bits_per_word );
+		}
+		if( word == last_word && arg_last % bits_per_word != 0 )
+		{
+			bits &= ~( ~uint64_t( 0 ) << ( arg_last % bits_per_word ) );
+		}
+		while( bits != 0 )
+		{
+			size_t bit = detail::countTrailingZeros( bits );
+			bits &= bits - 1; // clear lowest set bit
+			arg_function( objects_[word * bits_per_word + bit] );
+		}
+	}
+}
+template <class T>
+inline size_t TypedPool<T>::IndexOf( const T* arg_ptr ) const
+{
+	HSA_ASSERT( arg_ptr >= objects_ && arg_ptr < objects_ + capacity_ ); // object is not part of the pool
+	return static_cast< size_t >( arg_ptr - objects_ );
+}
+template <class T>
+inline size_t TypedPool<T>::Capacity() const
+{
+	return capacity_;
+}
+template <class T>
+inline size_t TypedPool<T>::Size() const
+{
+	return live_count_;
+}
+#pragma endregion
+#pragma region FreeListAllocatorImplementation
+namespace detail
+{
+	/**
+	* @brief finds the start and size of the block of an allocation from its allocation header.
+	*/
+	inline void allocationBlock( void* arg_ptr, char*& arg_block, size_t& arg_block_size )
+	{
+		auto* alloc_header = reinterpret_cast< CompactAllocationHeader* >( arg_ptr ) - 1;
+		size_t padding = alloc_header->Padding();
+		arg_block = reinterpret_cast< char* >( arg_ptr ) - alloc_header->HeaderSize() - padding;
+		arg_block_size = padding + alloc_header->HeaderSize() + alloc_header->Size();
+	}
+	/**
+	* @brief merges the free block of arg_rhs into arg_lhs if they are neighbours. arg_rhs has to follow arg_lhs in the list.
+	*/
+	inline bool Merge2ItrBlocks( OrderedList<FreeListHeader*>& arg_list, Allocator& arg_header_allocator, OrderedList<FreeListHeader*>::Iterator& arg_lhs,  OrderedList<FreeListHeader*>::Iterator& arg_rhs)
+	{
+		bool result = false;
+		if( arg_lhs != arg_list.End() && arg_rhs != arg_list.End() )
+		{
+			result = reinterpret_cast<void*>(reinterpret_cast<size_t>((*arg_lhs)->header_ptr_) + (*arg_lhs)->size_) == (*arg_rhs)->header_ptr_;
+			if( result )
+			{
+				FreeListHeader* rhs_header = *arg_rhs;
+				( *arg_lhs )->size_ += rhs_header->size_;
+				arg_list.EraseAfter( arg_lhs );
+				arg_header_allocator.Free( rhs_header );
+			}
+		}
+		return result;
+	}
+}
+FreeListAllocator::FreeListAllocator() 
+{
+#ifndef HSA_NO_MALLOC
+	mem_pool_ = static_cast< char* >( malloc( pool_size_ = MIBI( 50 ) ) );
+#endif
+	HSA_ASSERT( mem_pool_ );
+	Init();
+}
+FreeListAllocator::FreeListAllocator( size_t arg_size, Allocator* arg_allocator ) :
+	allocator_( arg_allocator )
+{
+	pool_size_ = arg_size;
+	if( arg_allocator )
+	{
+		mem_pool_ = static_cast< char* >( arg_allocator->Allocate( pool_size_, 16 ) );
+	}
+	else
+	{
+#ifndef HSA_NO_MALLOC
+		mem_pool_ = static_cast< char* >( malloc( pool_size_ ) );
+#endif
+	}
+	HSA_ASSERT( mem_pool_ );
+	Init();
+}
+FreeListAllocator::~FreeListAllocator()
+{
+	detail::pageMapUnregister( this, mem_pool_, pool_size_ );
+	free_list_->Abandon(); // nodes are freed with the header pool.
+	free_list_->~OrderedList();
+	allocator_->Free( free_list_ );
+	header_pool_->~SlotPool();
+	allocator_->Free( header_pool_ );
+	if( has_custom_allocator_ == false )
+	{
+#ifndef HSA_NO_MALLOC
+		static_cast< MallocAllocator* >( allocator_ )->~MallocAllocator();
+		free( allocator_ );
+#endif // !HSA_NO_MALLOC
+		allocator_ = nullptr;
+	}
+	if( allocator_ )
+	{
+		allocator_->Free( mem_pool_ );
+	}
+	else
+	{
+#ifndef HSA_NO_MALLOC
+		free( mem_pool_ );
+#endif // !HSA_NO_MALLOC
+
+	}
+}
+inline void FreeListAllocator::Init()
+{
+	if( allocator_ == nullptr )
+	{
+		has_custom_allocator_ = false;
+#ifndef HSA_NO_MALLOC
+		void* mem_block = malloc( sizeof( MallocAllocator ) );
+		allocator_ = new( mem_block ) MallocAllocator;
+#endif // !HSA_NO_MALLOC
+	}
+	else
+	{
+		has_custom_allocator_ = true;
+	}
+	HSA_ASSERT( allocator_ != nullptr );
+
+	size_t slot_size = sizeof( FreeList::Node ) > sizeof( detail::FreeListHeader ) ? sizeof( FreeList::Node ) : sizeof( detail::FreeListHeader );
+	header_pool_ = new( allocator_->Allocate( sizeof( detail::SlotPool ) ) ) detail::SlotPool( slot_size, 256, allocator_ );
+	free_list_ = new (allocator_->Allocate(sizeof(FreeList))) FreeList( header_pool_ );
+	
+	free_list_->Insert( new(header_pool_->Allocate(sizeof(detail::FreeListHeader))) detail::FreeListHeader(mem_pool_ , pool_size_ ));
+	detail::pageMapRegister( this, mem_pool_, pool_size_ );
+}
+inline void* FreeListAllocator::Allocate( size_t arg_size, size_t arg_alignment )
+{
+	void* return_ptr = TryAllocate( arg_size, arg_alignment );
+	HSA_ASSERT( return_ptr != nullptr ) // out of memory
+	return return_ptr;
+}
+inline bool FreeListAllocator::Owns( const void* arg_ptr ) const
+{
+	return arg_ptr >= mem_pool_ && arg_ptr < mem_pool_ + pool_size_;
+}
+inline void* FreeListAllocator::TryAllocate( size_t arg_size, size_t arg_alignment )
+{
+	FreeList::Iterator itr = free_list_->Begin();
+	// keeps every block start aligned for the allocation header.
+	arg_size += detail::calcAlignedOffset( arg_size, detail::CompactAllocationHeader::granularity );
+
+	while( itr != free_list_->End() )
+	{
+		auto* header = *itr;
+		size_t header_size = sizeof( detail::CompactAllocationHeader );
+		size_t aligned_offset = detail::calcAlignedOffset( reinterpret_cast< size_t >( header->header_ptr_ ) + header_size, arg_alignment );
+		while( aligned_offset != 0 && aligned_offset < sizeof( uint64_t ) )
+		{
+			aligned_offset += arg_alignment; // padding has to be able to hold its own size.
+		}
+		if( aligned_offset > detail::CompactAllocationHeader::max_short_padding )
+		{
+			// padding does not fit in the header. use a wide header that stores it in an extra word.
+			header_size += sizeof( uint64_t );
+			aligned_offset = detail::calcAlignedOffset( reinterpret_cast< size_t >( header->header_ptr_ ) + header_size, arg_alignment );
+			while( aligned_offset != 0 && aligned_offset < sizeof( uint64_t ) )
+			{
+				aligned_offset += arg_alignment;
+			}
+		}
+		size_t total_size = arg_size + header_size;
+		size_t total_aligned_size = total_size + aligned_offset;
+
+		if( header->size_ >= total_aligned_size )
+		{
+			free_list_->Erase( header );
+			char* raw_ptr = reinterpret_cast<char*>( header->header_ptr_ );
+			if( aligned_offset != 0 )
+			{
+				*reinterpret_cast< uint64_t* >( raw_ptr ) = aligned_offset; // lets Walk() find the allocation header.
+			}
+			raw_ptr += aligned_offset + header_size;
+			auto* alloc_header = reinterpret_cast< detail::CompactAllocationHeader* >( raw_ptr ) - 1;
+			size_t alloc_size = arg_size;
+			if( header->size_ >= total_aligned_size + sizeof( detail::CompactAllocationHeader ) + detail::FreeList::minimum_header_size )// split header.
+			{
+				free_list_->Insert( new( header_pool_->Allocate( sizeof( detail::FreeListHeader ) ) )detail::FreeListHeader( raw_ptr + arg_size, header->size_ - total_aligned_size ) );
+
+			}
+			else if( header->size_ > total_aligned_size )// bigger than but not big enough.
+			{
+				alloc_size += header->size_ - total_aligned_size; // add remainder to the size so it does not get lost.
+			}
+			alloc_header->Set( alloc_size, aligned_offset, header_size != sizeof( detail::CompactAllocationHeader ) );
+			header_pool_->Free( header );
+			return raw_ptr;
+		}
+		++itr;
+	}
+	return nullptr;
+}
+inline void FreeListAllocator::Free( void* arg_ptr)
+{
+	char* raw_ptr = nullptr;
+	size_t mem_size = 0;
+	detail::allocationBlock( arg_ptr, raw_ptr, mem_size );
+	free_list_->Insert( new( header_pool_->Allocate( sizeof( detail::FreeListHeader ) ) ) detail::FreeListHeader( raw_ptr, mem_size ) );
+	if( trim_threshold_ != 0 )
+	{
+		freed_since_trim_ += mem_size;
+		if( freed_since_trim_ >= trim_threshold_ )
+		{
+			Trim();
+		}
+	}
+}
+inline void FreeListAllocator::FreeBatch( void* const* arg_ptrs, size_t arg_count )
+{
+	auto** headers = static_cast< detail::FreeListHeader** >( allocator_->TryAllocate( arg_count * sizeof( detail::FreeListHeader* ), alignof( detail::FreeListHeader* ) ) );
+	if( headers == nullptr )
+	{
+		for( size_t i = 0; i < arg_count; i++ )
+		{
+			if( arg_ptrs[i] != nullptr )
+			{
+				Free( arg_ptrs[i] );
+			}
+		}
+		return;
+	}
+
+	size_t header_count = 0;
+	size_t freed_size = 0;
+	for( size_t i = 0; i < arg_count; i++ )
+	{
+		if( arg_ptrs[i] == nullptr )
+		{
+			continue;
+		}
+		char* raw_ptr = nullptr;
+		size_t mem_size = 0;
+		detail::allocationBlock( arg_ptrs[i], raw_ptr, mem_size );
+		headers[header_count++] = new( header_pool_->Allocate( sizeof( detail::FreeListHeader ) ) ) detail::FreeListHeader( raw_ptr, mem_size );
+		freed_size += mem_size;
+	}
+
+	std::sort( headers, headers + header_count,
+		[]( const detail::FreeListHeader* arg_lhs, const detail::FreeListHeader* arg_rhs )
+		{
+			return arg_lhs->header_ptr_ < arg_rhs->header_ptr_;
+		} );
+
+	// merge neighbours inside the batch before they are inserted.
+	size_t merged_count = 0;
+	for( size_t i = 0; i < header_count; i++ )
+	{
+		if( merged_count != 0 && reinterpret_cast< char* >( headers[merged_count - 1]->header_ptr_ ) + headers[merged_count - 1]->size_ == headers[i]->header_ptr_ )
+		{
+			headers[merged_count - 1]->size_ += headers[i]->size_;
+			header_pool_->Free( headers[i] );
+		}
+		else
+		{
+			headers[merged_count++] = headers[i];
+		}
+	}
+
+	free_list_->InsertSorted( headers, merged_count );
+	allocator_->FreeSized( headers, arg_count * sizeof( detail::FreeListHeader* ) );
+	Defragment(); // merges the batch with free blocks that were already in the list.
+
+	if( trim_threshold_ != 0 )
+	{
+		freed_since_trim_ += freed_size;
+		if( freed_since_trim_ >= trim_threshold_ )
+		{
+			Trim();
+		}
+	}
+}
+inline void FreeListAllocator::Reset()
+{
+	// releases all list nodes and headers at once instead of freeing them one by one.
+	free_list_->Abandon();
+	header_pool_->Reset();
+	free_list_->Insert( new( header_pool_->Allocate( sizeof( detail::FreeListHeader ) ) ) detail::FreeListHeader( mem_pool_, pool_size_ ) );
+}
+inline void FreeListAllocator::Walk( HeapWalkCallback arg_callback, void* arg_user_data ) const
+{
+	FreeList::Iterator free_itr = free_list_->Begin();
+	char* block_ptr = mem_pool_;
+	char* pool_end = mem_pool_ + pool_size_;
+	while( block_ptr < pool_end )
+	{
+		HeapBlock block;
+		block.offset_ = block_ptr - mem_pool_;
+		if( free_itr != free_list_->End() && ( *free_itr )->header_ptr_ == block_ptr )
+		{
+			block.size_ = ( *free_itr )->size_;
+			block.padding_ = 0;
+			block.header_size_ = 0;
+			block.is_free_ = true;
+			++free_itr;
+		}
+		else
+		{
+			// the first word of a used block is either the allocation header or the padding in front of it.
+			uint64_t first_word = *reinterpret_cast< uint64_t* >( block_ptr );
+			size_t padding = ( first_word & detail::CompactAllocationHeader::tag_bit ) ? 0 : static_cast< size_t >( first_word );
+			auto* alloc_header = reinterpret_cast< detail::CompactAllocationHeader* >( block_ptr + padding );
+			if( ( alloc_header->word_ & detail::CompactAllocationHeader::tag_bit ) == 0 )
+			{
+				++alloc_header; // wide header. the word in front of it holds the padding.
+			}
+			HSA_ASSERT( alloc_header->Padding() == padding ); // corrupted pool
+			block.size_ = padding + alloc_header->HeaderSize() + alloc_header->Size();
+			block.padding_ = padding;
+			block.header_size_ = alloc_header->HeaderSize();
+			block.is_free_ = false;
+		}
+		arg_callback( block, arg_user_data );
+		block_ptr += block.size_;
+	}
+}
+inline size_t FreeListAllocator::Trim()
+{
+	Defragment(); // neighbouring free blocks can share pages.
+	detail::TrimContext context = { mem_pool_, 0 };
+	Walk( detail::trimBlock, &context );
+	freed_since_trim_ = 0;
+	return context.released_;
+}
+inline void FreeListAllocator::SetTrimThreshold( size_t arg_threshold )
+{
+	trim_threshold_ = arg_threshold;
+}
+inline void FreeListAllocator::Defragment()
+{
+	auto itr = free_list_->Begin();
+	if( itr != free_list_->End() )
+	{
+		bool is_done = false;
+		while( is_done == false )
+		{
+			auto next = itr + 1;
+			if( next != free_list_->End() )
+			{
+				bool result = detail::Merge2ItrBlocks(*free_list_, *header_pool_, itr, next);
+				if( result == false )
+				{
+					itr = next;
+				}
+			}
+			else
+			{
+				is_done = true;
+			}
+		}
+	}
+}
+#pragma endregion
+#pragma region BuddyAllocatorImplementation
+BuddyAllocator::BuddyAllocator( size_t arg_pool_size, size_t arg_min_block_size, Allocator* arg_allocator ) :
+	allocator_( arg_allocator )
+{
+	HSA_ASSERT( arg_min_block_size >= sizeof( detail::BuddyFreeBlock ) && ( arg_min_block_size & ( arg_min_block_size - 1 ) ) == 0 );
+	min_block_shift_ = detail::countTrailingZeros( arg_min_block_size );
+	pool_size_ = arg_min_block_size;
+	while( pool_size_ < arg_pool_size )
+	{
+		pool_size_ <<= 1;
+	}
+	order_count_ = detail::countTrailingZeros( pool_size_ ) - min_block_shift_ + 1;
+
+	size_t bit_count = 0;
+	for( size_t order = 0; order < order_count_; order++ )
+	{
+		bitmap_offsets_[order] = bit_count;
+		bit_count += pool_size_ >> ( min_block_shift_ + order );
+	}
+	size_t bitmap_size = ( bit_count + 63 ) / 64 * sizeof( uint64_t );
+	size_t block_orders_size = pool_size_ >> min_block_shift_;
+	size_t pool_alignment = pool_size_ < max_pool_alignment ? pool_size_ : max_pool_alignment;
+
+	void* bookkeeping = nullptr;
+	if( allocator_ )
+	{
+		mem_pool_ = static_cast< char* >( allocator_->Allocate( pool_size_, pool_alignment ) );
+		bookkeeping = allocator_->Allocate( bitmap_size + block_orders_size, alignof( uint64_t ) );
+	}
+	else
+	{
+#ifndef HSA_NO_MALLOC
+		raw_pool_ = malloc( pool_size_ + pool_alignment );
+		if( raw_pool_ )
+		{
+			size_t raw_address = reinterpret_cast< size_t >( raw_pool_ );
+			mem_pool_ = static_cast< char* >( raw_pool_ ) + ( ( pool_alignment - raw_address % pool_alignment ) % pool_alignment );
+		}
+		bookkeeping = malloc( bitmap_size + block_orders_size );
+#endif // !HSA_NO_MALLOC
+	}
+	HSA_ASSERT( mem_pool_ && bookkeeping );
+	free_bits_ = static_cast< uint64_t* >( bookkeeping );
+	block_orders_ = static_cast< unsigned char* >( bookkeeping ) + bitmap_size;
+	Reset();
+	detail::pageMapRegister( this, mem_pool_, pool_size_ );
+}
+BuddyAllocator::~BuddyAllocator()
+{
+	detail::pageMapUnregister( this, mem_pool_, pool_size_ );
+	if( allocator_ )
+	{
+		allocator_->Free( mem_pool_ );
+		allocator_->Free( free_bits_ );
+	}
+	else
+	{
+#ifndef HSA_NO_MALLOC
+		free( raw_pool_ );
+		free( free_bits_ );
+#endif // !HSA_NO_MALLOC
+	}
+}
+inline void* BuddyAllocator::Allocate( size_t arg_size, size_t arg_alignment )
+{
+	void* ret_ptr = TryAllocate( arg_size, arg_alignment );
+	HSA_ASSERT( ret_ptr != nullptr ) // out of memory
+	return ret_ptr;
+}
+inline void* BuddyAllocator::TryAllocate( size_t arg_size, size_t arg_alignment )
+{
+	size_t pool_alignment = pool_size_ < max_pool_alignment ? pool_size_ : max_pool_alignment;
+	if( arg_alignment > pool_alignment )
+	{
+		HSA_ASSERT( false ) // alignment is bigger than the alignment of the pool
+		return nullptr;
+	}
+	size_t size = arg_size > arg_alignment ? arg_size : arg_alignment; // blocks are aligned to their size.
+	if( size > pool_size_ )
+	{
+		return nullptr;
+	}
+	size_t order = OrderOf( size );
+	uint64_t candidates = free_orders_ >> order;
+	if( candidates == 0 )
+	{
+		return nullptr;
+	}
+
+	// take the smallest free block that fits and split it until it has the requested order.
+	size_t block_order = order + detail::countTrailingZeros( candidates );
+	size_t offset = static_cast< size_t >( reinterpret_cast< char* >( free_lists_[block_order] ) - mem_pool_ );
+	RemoveFree( block_order, offset );
+	while( block_order > order )
+	{
+		--block_order;
+		PushFree( block_order, offset + ( size_t( 1 ) << ( min_block_shift_ + block_order ) ) );
+	}
+	block_orders_[offset >> min_block_shift_] = static_cast< unsigned char >( order + 1 );
+	free_size_ -= size_t( 1 ) << ( min_block_shift_ + order );
+	return mem_pool_ + offset;
+}
+inline void BuddyAllocator::Free( void* arg_ptr )
+{
+	if( arg_ptr == nullptr )
+	{
+		return;
+	}
+	HSA_ASSERT( Owns( arg_ptr ) ); // memory was not allocated by this allocator
+	size_t offset = static_cast< size_t >( static_cast< char* >( arg_ptr ) - mem_pool_ );
+	size_t index = offset >> min_block_shift_;
+	HSA_ASSERT( block_orders_[index] != 0 ); // not the start of an allocation or freed twice
+	size_t order = block_orders_[index] - 1u;
+	block_orders_[index] = 0;
+	free_size_ += size_t( 1 ) << ( min_block_shift_ + order );
+
+	// merge with the buddy as long as it is free. the merged block starts at the lower of the two.
+	while( order + 1 < order_count_ )
+	{
+		size_t block_size = size_t( 1 ) << ( min_block_shift_ + order );
+		size_t buddy_offset = offset ^ block_size;
+		size_t buddy_bit = BitOf( order, buddy_offset );
+		if( ( free_bits_[buddy_bit / 64] & ( uint64_t( 1 ) << ( buddy_bit % 64 ) ) ) == 0 )
+		{
+			break;
+		}
+		RemoveFree( order, buddy_offset );
+		offset &= ~block_size;
+		++order;
+	}
+	PushFree( order, offset );
+}
+inline bool BuddyAllocator::Owns( const void* arg_ptr ) const
+{
+	return arg_ptr >= mem_pool_ && arg_ptr < mem_pool_ + pool_size_;
+}
+inline void BuddyAllocator::Reset()
+{
+	size_t bit_count = bitmap_offsets_[order_count_ - 1] + 1;
+	memset( free_bits_, 0, ( bit_count + 63 ) / 64 * sizeof( uint64_t ) );
+	memset( block_orders_, 0, pool_size_ >> min_block_shift_ );
+	for( size_t order = 0; order < max_orders; order++ )
+	{
+		free_lists_[order] = nullptr;
+	}
+	free_orders_ = 0;
+	free_size_ = pool_size_;
+	PushFree( order_count_ - 1, 0 );
+}
+inline size_t BuddyAllocator::BlockSize( const void* arg_ptr ) const
+{
+	HSA_ASSERT( Owns( arg_ptr ) );
+	size_t index = static_cast< size_t >( static_cast< const char* >( arg_ptr ) - mem_pool_ ) >> min_block_shift_;
+	HSA_ASSERT( block_orders_[index] != 0 ); // not the start of an allocation
+	return size_t( 1 ) << ( min_block_shift_ + block_orders_[index] - 1 );
+}
+inline size_t BuddyAllocator::LargestFreeBlock() const
+{
+	if( free_orders_ == 0 )
+	{
+		return 0;
+	}
+	return size_t( 1 ) << ( min_block_shift_ + detail::highestBit( free_orders_ ) );
+}
+inline size_t BuddyAllocator::FreeSize() const
+{
+	return free_size_;
+}
+inline size_t BuddyAllocator::PoolSize() const
+{
+	return pool_size_;
+}
+inline size_t BuddyAllocator::OrderOf( size_t arg_size ) const
+{
+	if( arg_size <= ( size_t( 1 ) << min_block_shift_ ) )
+	{
+		return 0;
+	}
+	return detail::highestBit( arg_size - 1 ) + 1 - min_block_shift_;
+}
+inline size_t BuddyAllocator::BitOf( size_t arg_order, size_t arg_offset ) const
+{
+	return bitmap_offsets_[arg_order] + ( arg_offset >> ( min_block_shift_ + arg_order ) );
+}
+inline void BuddyAllocator::PushFree( size_t arg_order, size_t arg_offset )
+{
+	detail::BuddyFreeBlock* block = reinterpret_cast< detail::BuddyFreeBlock* >( mem_pool_ + arg_offset );
+	block->previous_ = nullptr;
+	block->next_ = free_lists_[arg_order];
+	if( block->next_ != nullptr )
+	{
+		block->next_->previous_ = block;
+	}
+	free_lists_[arg_order] = block;
+	free_orders_ |= uint64_t( 1 ) << arg_order;
+	size_t bit = BitOf( arg_order, arg_offset );
+	free_bits_[bit / 64] |= uint64_t( 1 ) << ( bit % 64 );
+}
+inline void BuddyAllocator::RemoveFree( size_t arg_order, size_t arg_offset )
+{
+	detail::BuddyFreeBlock* block = reinterpret_cast< detail::BuddyFreeBlock* >( mem_pool_ + arg_offset );
+	if( block->previous_ != nullptr )
+	{
+		block->previous_->next_ = block->next_;
+	}
+	else
+	{
+		free_lists_[arg_order] = block->next_;
+	}
+	if( block->next_ != nullptr )
+	{
+		block->next_->previous_ = block->previous_;
+	}
+	if( free_lists_[arg_order] == nullptr )
+	{
+		free_orders_ &= ~( uint64_t( 1 ) << arg_order );
+	}
+	size_t bit = BitOf( arg_order, arg_offset );
+	free_bits_[bit / 64] &= ~( uint64_t( 1 ) << ( bit % 64 ) );
+}
+#pragma endregion
+#pragma region CompactingAllocatorImplementation
+CompactingAllocator::CompactingAllocator( size_t arg_size, size_t arg_max_handles, Allocator* arg_allocator ) :
+	allocator_( arg_allocator )
+{
+	HSA_ASSERT( arg_max_handles > 0 && arg_max_handles <= PoolHandle::max_index + 1 );
+	pool_size_ = arg_size - arg_size % alignment;
+	handle_count_ = arg_max_handles;
+	if( arg_allocator )
+	{
+		mem_pool_ = static_cast< char* >( arg_allocator->Allocate( pool_size_, alignment ) );
+		handles_ = static_cast< detail::CompactingHandleEntry* >( arg_allocator->Allocate( handle_count_ * sizeof( detail::CompactingHandleEntry ), alignof( detail::CompactingHandleEntry ) ) );
+	}
+	else
+	{
+#ifndef HSA_NO_MALLOC
+		mem_pool_ = static_cast< char* >( malloc( pool_size_ ) );
+		handles_ = static_cast< detail::CompactingHandleEntry* >( malloc( handle_count_ * sizeof( detail::CompactingHandleEntry ) ) );
+#endif // !HSA_NO_MALLOC
+	}
+	HSA_ASSERT( mem_pool_ && handles_ )
+	for( size_t i = 0; i < handle_count_; i++ )
+	{
+		handles_[i].offset_ = i + 1;
+		handles_[i].generation_ = 1;
+		handles_[i].pin_count_ = 0;
+	}
+}
+CompactingAllocator::~CompactingAllocator()
+{
+	if( allocator_ )
+	{
+		allocator_->Free( mem_pool_ );
+		allocator_->Free( handles_ );
+	}
+	else
+	{
+#ifndef HSA_NO_MALLOC
+		free( mem_pool_ );
+		free( handles_ );
+#endif // !HSA_NO_MALLOC
+	}
+}
+inline detail::CompactingBlockHeader* CompactingAllocator::BlockAt( size_t arg_offset ) const
+{
+	return reinterpret_cast< detail::CompactingBlockHeader* >( mem_pool_ + arg_offset );
+}
+inline detail::CompactingHandleEntry* CompactingAllocator::EntryOf( PoolHandle arg_handle ) const
+{
+	size_t index = arg_handle.Index();
+	if( index >= handle_count_ || handles_[index].generation_ != arg_handle.Generation() )
+	{
+		return nullptr;
+	}
+	return handles_ + index;
+}
+inline PoolHandle CompactingAllocator::CreateHandle( size_t arg_offset )
+{
+	size_t index = free_handle_;
+	detail::CompactingHandleEntry& entry = handles_[index];
+	free_handle_ = entry.offset_;
+	entry.offset_ = arg_offset;
+	entry.pin_count_ = 0;
+
+	detail::CompactingBlockHeader* block = BlockAt( arg_offset );
+	block->handle_index_ = static_cast< uint32_t >( index );
+	block->is_free_ = 0;
+	used_bytes_ += block->size_;
+	return PoolHandle( index, entry.generation_ );
+}
+inline PoolHandle CompactingAllocator::Allocate( size_t arg_size )
+{
+	HSA_ASSERT( free_handle_ < handle_count_ ); // out of handles
+	if( free_handle_ >= handle_count_ )
+	{
+		return PoolHandle();
+	}
+	size_t block_size = arg_size + sizeof( detail::CompactingBlockHeader );
+	block_size += detail::calcAlignedOffset( block_size, alignment );
+
+	if( top_ + block_size <= pool_size_ )
+	{
+		size_t offset = top_;
+		BlockAt( offset )->size_ = block_size;
+		top_ += block_size;
+		return CreateHandle( offset );
+	}
+
+	// first fit in the gaps. neighbouring free blocks are merged on the way.
+	size_t offset = 0;
+	while( offset < top_ )
+	{
+		detail::CompactingBlockHeader* block = BlockAt( offset );
+		if( block->is_free_ )
+		{
+			size_t next = offset + block->size_;
+			while( next < top_ && BlockAt( next )->is_free_ )
+			{
+				if( next == compact_offset_ )
+				{
+					compact_offset_ = offset;
+				}
+				block->size_ += BlockAt( next )->size_;
+				next += BlockAt( next )->size_;
+			}
+			if( next == top_ )
+			{
+				top_ = offset; // free space at the top is not a gap.
+				if( compact_offset_ > top_ )
+				{
+					compact_offset_ = top_;
+				}
+				break;
+			}
+			if( block->size_ >= block_size )
+			{
+				size_t remainder = block->size_ - block_size;
+				if( remainder >= sizeof( detail::CompactingBlockHeader ) )
+				{
+					detail::CompactingBlockHeader* remainder_block = BlockAt( offset + block_size );
+					remainder_block->size_ = remainder;
+					remainder_block->is_free_ = 1;
+					block->size_ = block_size;
+				}
+				return CreateHandle( offset );
+			}
+		}
+		offset += block->size_;
+	}
+	if( top_ + block_size <= pool_size_ )
+	{
+		offset = top_;
+		BlockAt( offset )->size_ = block_size;
+		top_ += block_size;
+		return CreateHandle( offset );
+	}
+
+	if( used_bytes_ + block_size <= pool_size_ )
+	{
+		Compact();
+		if( top_ + block_size <= pool_size_ )
+		{
+			offset = top_;
+			BlockAt( offset )->size_ = block_size;
+			top_ += block_size;
+			return CreateHandle( offset );
+		}
+	}
+	HSA_ASSERT( false ) // out of memory
+	return PoolHandle();
+}
+inline void CompactingAllocator::Free( PoolHandle arg_handle )
+{
+	detail::CompactingHandleEntry* entry = EntryOf( arg_handle );
+	HSA_ASSERT( entry != nullptr ) // freeing a stale handle
+	if( entry == nullptr )
+	{
+		return;
+	}
+	HSA_ASSERT( entry->pin_count_ == 0 ) // freeing pinned memory
+
+	detail::CompactingBlockHeader* block = BlockAt( entry->offset_ );
+	block->is_free_ = 1;
+	used_bytes_ -= block->size_;
+	if( entry->offset_ + block->size_ == top_ )
+	{
+		top_ = entry->offset_;
+		if( compact_offset_ > top_ )
+		{
+			compact_offset_ = top_;
+		}
+	}
+
+	size_t index = arg_handle.Index();
+	entry->generation_ = entry->generation_ + 1 > PoolHandle::max_generation ? 1 : entry->generation_ + 1;
+	entry->offset_ = free_handle_;
+	free_handle_ = index;
+}
+inline void* CompactingAllocator::Resolve( PoolHandle arg_handle ) const
+{
+	detail::CompactingHandleEntry* entry = EntryOf( arg_handle );
+	if( entry == nullptr )
+	{
+		return nullptr;
+	}
+	return mem_pool_ + entry->offset_ + sizeof( detail::CompactingBlockHeader );
+}
+inline void* CompactingAllocator::Pin( PoolHandle arg_handle )
+{
+	detail::CompactingHandleEntry* entry = EntryOf( arg_handle );
+	if( entry == nullptr )
+	{
+		return nullptr;
+	}
+	++entry->pin_count_;
+	return mem_pool_ + entry->offset_ + sizeof( detail::CompactingBlockHeader );
+}
+inline void CompactingAllocator::Unpin( PoolHandle arg_handle )
+{
+	detail::CompactingHandleEntry* entry = EntryOf( arg_handle );
+	HSA_ASSERT( entry != nullptr && entry->pin_count_ > 0 ) // unpinning a handle that is not pinned
+	if( entry != nullptr && entry->pin_count_ > 0 )
+	{
+		--entry->pin_count_;
+	}
+}
+inline bool CompactingAllocator::CompactStep( size_t arg_step_count )
+{
+	// blocks between write and read are free. live blocks are moved down to write.
+	size_t write = compact_offset_;
+	size_t read = compact_offset_;
+	for( size_t step = 0; step < arg_step_count && read < top_; step++ )
+	{
+		detail::CompactingBlockHeader* block = BlockAt( read );
+		size_t block_size = block->size_;
+		if( block->is_free_ )
+		{
+			read += block_size;
+			continue;
+		}
+		detail::CompactingHandleEntry& entry = handles_[block->handle_index_];
+		if( entry.pin_count_ != 0 )
+		{
+			if( write < read )
+			{
+				detail::CompactingBlockHeader* gap = BlockAt( write );
+				gap->size_ = read - write;
+				gap->is_free_ = 1;
+			}
+			write = read + block_size;
+		}
+		else
+		{
+			if( write < read )
+			{
+				memmove( mem_pool_ + write, mem_pool_ + read, block_size );
+				entry.offset_ = write;
+			}
+			write += block_size;
+		}
+		read += block_size;
+	}
+
+	if( read >= top_ )
+	{
+		top_ = write;
+		compact_offset_ = 0;
+		return true;
+	}
+	if( write < read )
+	{
+		detail::CompactingBlockHeader* gap = BlockAt( write );
+		gap->size_ = read - write;
+		gap->is_free_ = 1;
+	}
+	compact_offset_ = write;
+	return false;
+}
+inline bool CompactingAllocator::Compact( std::chrono::microseconds arg_time_budget )
+{
+	const size_t steps_per_check = 64;
+	std::chrono::steady_clock::time_point end_time = std::chrono::steady_clock::now() + arg_time_budget;
+	do
+	{
+		if( CompactStep( steps_per_check ) )
+		{
+			return true;
+		}
+	} while( std::chrono::steady_clock::now() < end_time );
+	return false;
+}
+inline void CompactingAllocator::Compact()
+{
+	compact_offset_ = 0;
+	while( CompactStep( static_cast< size_t >( -1 ) ) == false )
+	{
+	}
+}
+inline size_t CompactingAllocator::FreeBytes() const
+{
+	return pool_size_ - used_bytes_;
+}
+inline void CompactingAllocator::Walk( HeapWalkCallback arg_callback, void* arg_user_data ) const
+{
+	size_t offset = 0;
+	while( offset < top_ )
+	{
+		detail::CompactingBlockHeader* block_header = BlockAt( offset );
+		HeapBlock block;
+		block.offset_ = offset;
+		block.size_ = block_header->size_;
+		block.padding_ = 0;
+		block.header_size_ = block_header->is_free_ ? 0 : sizeof( detail::CompactingBlockHeader );
+		block.is_free_ = block_header->is_free_ != 0;
+		arg_callback( block, arg_user_data );
+		offset += block_header->size_;
+	}
+	if( top_ < pool_size_ )
+	{
+		HeapBlock block;
+		block.offset_ = top_;
+		block.size_ = pool_size_ - top_;
+		block.padding_ = 0;
+		block.header_size_ = 0;
+		block.is_free_ = true;
+		arg_callback( block, arg_user_data );
+	}
+}
+#pragma endregion
+#pragma region ArenaPoolImplementation
+template<class ArenaType>
+ArenaPool<ArenaType>::Scope::Scope( ArenaPool& arg_pool, size_t arg_size_hint ) :
+	pool_( arg_pool )
+{
+	current_ = pool_.Acquire( arg_size_hint > pool_.TypicalSize() ? arg_size_hint : pool_.TypicalSize() );
+}
+template<class ArenaType>
+ArenaPool<ArenaType>::Scope::~Scope()
+{
+	pool_.Record( UsedSize() );
+	while( current_ != nullptr )
+	{
+		Node* next = current_->next_;
+		pool_.Release( current_ );
+		current_ = next;
+	}
+}
+template<class ArenaType>
+inline void* ArenaPool<ArenaType>::Scope::Allocate( size_t arg_size, size_t arg_alignment )
+{
+	void* ret_ptr = TryAllocate( arg_size, arg_alignment );
+	HSA_ASSERT( ret_ptr != nullptr ) // out of memory
+	return ret_ptr;
+}
+template<class ArenaType>
+inline void* ArenaPool<ArenaType>::Scope::TryAllocate( size_t arg_size, size_t arg_alignment )
+{
+	void* ret_ptr = current_ != nullptr ? current_->TryAllocate( arg_size, arg_alignment ) : nullptr;
+	if( ret_ptr == nullptr )
+	{
+		// chain an arena that is at least twice as big. leave room for alignment and an allocation header.
+		size_t needed_size = arg_size + arg_alignment + sizeof( detail::StackHeader ) + detail::StackHeader::granularity;
+		size_t next_size = current_ != nullptr ? current_->PoolSize() * 2 : 0;
+		Node* node = pool_.Acquire( needed_size > next_size ? needed_size : next_size );
+		if( node != nullptr )
+		{
+			node->next_ = current_;
+			current_ = node;
+			ret_ptr = current_->TryAllocate( arg_size, arg_alignment );
+		}
+	}
+	return ret_ptr;
+}
+template<class ArenaType>
+inline void ArenaPool<ArenaType>::Scope::Free( void* arg_ptr )
+{
+	for( Node* node = current_; node != nullptr; node = node->next_ )
+	{
+		if( node->Owns( arg_ptr ) )
+		{
+			node->Free( arg_ptr );
+			return;
+		}
+	}
+	HSA_ASSERT( false ) // memory was not allocated by this scope
+}
+template<class ArenaType>
+inline size_t ArenaPool<ArenaType>::Scope::UsedSize() const
+{
+	// older arenas overflowed, count them as full.
+	size_t used_size = 0;
+	for( Node* node = current_; node != nullptr; node = node->next_ )
+	{
+		used_size += node == current_ ? node->UsedSize() : node->PoolSize();
+	}
+	return used_size;
+}
+
+template<class ArenaType>
+ArenaPool<ArenaType>::ArenaPool( size_t arg_min_arena_size, size_t arg_max_arena_size, Allocator* arg_allocator ) :
+	allocator_( arg_allocator ),
+	min_arena_size_( arg_min_arena_size )
+{
+	HSA_ASSERT( arg_min_arena_size > 0 && arg_min_arena_size <= arg_max_arena_size );
+	while( size_class_count_ < max_size_classes && ( min_arena_size_ << size_class_count_ ) <= arg_max_arena_size )
+	{
+		size_class_count_++;
+	}
+	typical_size_ = min_arena_size_;
+}
+template<class ArenaType>
+ArenaPool<ArenaType>::~ArenaPool()
+{
+	HSA_ASSERT( active_count_ == 0 ) // scope outlives its pool
+	ReleaseCached();
+}
+template<class ArenaType>
+inline void ArenaPool<ArenaType>::ReleaseCached()
+{
+	for( size_t i = 0; i < size_class_count_; i++ )
+	{
+		while( free_lists_[i] != nullptr )
+		{
+			Node* next = free_lists_[i]->next_;
+			DestroyNode( free_lists_[i] );
+			free_lists_[i] = next;
+		}
+	}
+}
+template<class ArenaType>
+inline size_t ArenaPool<ArenaType>::TypicalSize() const
+{
+	return typical_size_;
+}
+template<class ArenaType>
+inline size_t ArenaPool<ArenaType>::SizeClassOf( size_t arg_size ) const
+{
+	size_t size_class = 0;
+	while( size_class < size_class_count_ && ( min_arena_size_ << size_class ) < arg_size )
+	{
+		size_class++;
+	}
+	return size_class < size_class_count_ ? size_class : max_size_classes;
+}
+template<class ArenaType>
+inline typename ArenaPool<ArenaType>::Node* ArenaPool<ArenaType>::Acquire( size_t arg_size )
+{
+	size_t size_class = SizeClassOf( arg_size );
+	Node* node = nullptr;
+	if( size_class != max_size_classes && free_lists_[size_class] != nullptr )
+	{
+		node = free_lists_[size_class];
+		free_lists_[size_class] = node->next_;
+	}
+	else
+	{
+		void* mem_block = nullptr;
+		if( allocator_ )
+		{
+			mem_block = allocator_->Allocate( sizeof( Node ), alignof( Node ) );
+		}
+		else
+		{
+#ifndef HSA_NO_MALLOC
+			mem_block = malloc( sizeof( Node ) );
+#endif // !HSA_NO_MALLOC
+		}
+		HSA_ASSERT( mem_block )
+		if( mem_block == nullptr )
+		{
+			return nullptr;
+		}
+		// arenas above the largest size class get exactly the requested size.
+		node = new( mem_block ) Node( size_class != max_size_classes ? min_arena_size_ << size_class : arg_size, allocator_ );
+		node->size_class_ = size_class;
+	}
+	node->next_ = nullptr;
+	active_count_++;
+	return node;
+}
+template<class ArenaType>
+inline void ArenaPool<ArenaType>::Release( Node* arg_node )
+{
+	active_count_--;
+	if( arg_node->size_class_ == max_size_classes )
+	{
+		DestroyNode( arg_node );
+		return;
+	}
+	arg_node->Reset();
+	arg_node->next_ = free_lists_[arg_node->size_class_];
+	free_lists_[arg_node->size_class_] = arg_node;
+}
+template<class ArenaType>
+inline void ArenaPool<ArenaType>::DestroyNode( Node* arg_node )
+{
+	arg_node->~Node();
+	if( allocator_ )
+	{
+		allocator_->Free( arg_node );
+	}
+	else
+	{
+#ifndef HSA_NO_MALLOC
+		free( arg_node );
+#endif // !HSA_NO_MALLOC
+	}
+}
+template<class ArenaType>
+inline void ArenaPool<ArenaType>::Record( size_t arg_footprint )
+{
+	// grow at once, shrink slowly so a single small scope does not undo the size of busy scopes.
+	if( arg_footprint > typical_size_ )
+	{
+		typical_size_ = arg_footprint;
+	}
+	else
+	{
+		typical_size_ -= ( typical_size_ - arg_footprint ) / 8;
+	}
+	if( typical_size_ < min_arena_size_ )
+	{
+		typical_size_ = min_arena_size_;
+	}
+}
+#pragma endregion
+#pragma region RemoteFreeAllocatorImplementation
+inline void detail::RemoteFreeList::Push( void* arg_ptr )
+{
+	void* head = head_.load( std::memory_order_relaxed );
+	do
+	{
+		*reinterpret_cast< void** >( arg_ptr ) = head;
+	} while( !head_.compare_exchange_weak( head, arg_ptr, std::memory_order_release, std::memory_order_relaxed ) );
+}
+inline void* detail::RemoteFreeList::TakeAll()
+{
+	return head_.exchange( nullptr, std::memory_order_acquire );
+}
+inline bool detail::RemoteFreeList::IsEmpty() const
+{
+	return head_.load( std::memory_order_relaxed ) == nullptr;
+}
+namespace detail
+{
+	/**
+	* @brief frees a batch of remote frees in a pool.
+	*/
+	template<class PoolType>
+	inline void freeRemoteBatch( PoolType& arg_pool, void* const* arg_ptrs, size_t arg_count )
+	{
+		for( size_t i = 0; i < arg_count; i++ )
+		{
+			arg_pool.Free( arg_ptrs[i] );
+		}
+	}
+	inline void freeRemoteBatch( FreeListAllocator& arg_pool, void* const* arg_ptrs, size_t arg_count )
+	{
+		arg_pool.FreeBatch( arg_ptrs, arg_count ); // one pass over the free list instead of one per block.
+	}
+	template<class PoolType>
+	inline void collectRemoteFrees( PoolType& arg_pool, RemoteFreeList& arg_remote_frees )
+	{
+		const size_t batch_size = 256;
+		void* batch[batch_size];
+		size_t count = 0;
+		void* ptr = arg_remote_frees.TakeAll();
+		while( ptr != nullptr )
+		{
+			batch[count++] = ptr;
+			ptr = *reinterpret_cast< void** >( ptr );
+			if( count == batch_size )
+			{
+				freeRemoteBatch( arg_pool, batch, count );
+				count = 0;
+			}
+		}
+		if( count != 0 )
+		{
+			freeRemoteBatch( arg_pool, batch, count );
+		}
+	}
+}
+template<class PoolType>
+template<class... Args>
+RemoteFreeAllocator<PoolType>::RemoteFreeAllocator( Args&&... arg_args ) :
+	owner_( std::this_thread::get_id() ),
+	pool_( std::forward<Args>( arg_args )... )
+{
+}
+template<class PoolType>
+RemoteFreeAllocator<PoolType>::~RemoteFreeAllocator()
+{
+	detail::collectRemoteFrees( pool_, remote_frees_ );
+}
+template<class PoolType>
+inline void* RemoteFreeAllocator<PoolType>::Allocate( size_t arg_size, size_t arg_alignment )
+{
+	void* ret_ptr = TryAllocate( arg_size, arg_alignment );
+	HSA_ASSERT( ret_ptr != nullptr ) // out of memory
+	return ret_ptr;
+}
+template<class PoolType>
+inline void* RemoteFreeAllocator<PoolType>::TryAllocate( size_t arg_size, size_t arg_alignment )
+{
+	HSA_ASSERT( IsOwner() ) // only the owner thread can allocate
+	if( !remote_frees_.IsEmpty() )
+	{
+		Collect();
+	}
+	return pool_.TryAllocate( arg_size < sizeof( void* ) ? sizeof( void* ) : arg_size, arg_alignment );
+}
+template<class PoolType>
+inline void RemoteFreeAllocator<PoolType>::Free( void* arg_ptr )
+{
+	if( IsOwner() )
+	{
+		pool_.Free( arg_ptr );
+	}
+	else
+	{
+		remote_frees_.Push( arg_ptr );
+	}
+}
+template<class PoolType>
+inline void RemoteFreeAllocator<PoolType>::Collect()
+{
+	HSA_ASSERT( IsOwner() ) // only the owner thread can collect
+	detail::collectRemoteFrees( pool_, remote_frees_ );
+}
+template<class PoolType>
+inline void RemoteFreeAllocator<PoolType>::SetOwner()
+{
+	owner_.store( std::this_thread::get_id(), std::memory_order_release );
+}
+template<class PoolType>
+inline bool RemoteFreeAllocator<PoolType>::IsOwner() const
+{
+	return std::this_thread::get_id() == owner_.load( std::memory_order_acquire );
+}
+template<class PoolType>
+inline PoolType& RemoteFreeAllocator<PoolType>::Pool()
+{
+	return pool_;
+}
+
+template<size_t ChunkSize>
+template<class... Args>
+RemoteFreeAllocator<BitmapAllocator<ChunkSize>>::RemoteFreeAllocator( Args&&... arg_args ) :
+	owner_( std::this_thread::get_id() ),
+	pool_( std::forward<Args>( arg_args )... )
+{
+}
+template<size_t ChunkSize>
+RemoteFreeAllocator<BitmapAllocator<ChunkSize>>::~RemoteFreeAllocator()
+{
+	detail::collectRemoteFrees( pool_, remote_frees_ );
+}
+template<size_t ChunkSize>
+inline void* RemoteFreeAllocator<BitmapAllocator<ChunkSize>>::Allocate()
+{
+	void* ret_ptr = TryAllocate();
+	HSA_ASSERT( ret_ptr != nullptr ) // out of memory
+	return ret_ptr;
+}
+template<size_t ChunkSize>
+inline void* RemoteFreeAllocator<BitmapAllocator<ChunkSize>>::TryAllocate()
+{
+	HSA_ASSERT( IsOwner() ) // only the owner thread can allocate
+	if( !remote_frees_.IsEmpty() )
+	{
+		Collect();
+	}
+	return pool_.TryAllocate();
+}
+template<size_t ChunkSize>
+inline void RemoteFreeAllocator<BitmapAllocator<ChunkSize>>::Free( void* arg_ptr )
+{
+	if( IsOwner() )
+	{
+		pool_.Free( arg_ptr );
+	}
+	else
+	{
+		remote_frees_.Push( arg_ptr );
+	}
+}
+template<size_t ChunkSize>
+inline void RemoteFreeAllocator<BitmapAllocator<ChunkSize>>::Collect()
+{
+	HSA_ASSERT( IsOwner() ) // only the owner thread can collect
+	detail::collectRemoteFrees( pool_, remote_frees_ );
+}
+template<size_t ChunkSize>
+inline void RemoteFreeAllocator<BitmapAllocator<ChunkSize>>::SetOwner()
+{
+	owner_.store( std::this_thread::get_id(), std::memory_order_release );
+}
+template<size_t ChunkSize>
+inline bool RemoteFreeAllocator<BitmapAllocator<ChunkSize>>::IsOwner() const
+{
+	return std::this_thread::get_id() == owner_.load( std::memory_order_acquire );
+}
+template<size_t ChunkSize>
+inline BitmapAllocator<ChunkSize>& RemoteFreeAllocator<BitmapAllocator<ChunkSize>>::Pool()
+{
+	return pool_;
+}
+#pragma endregion
+#pragma region IOBufferPoolImplementation
+detail::IOBufferMemory::IOBufferMemory( size_t arg_buffers_size, size_t arg_alignment, size_t arg_bookkeeping_size, Allocator* arg_allocator ) :
+	allocator_( arg_allocator )
+{
+	if( allocator_ )
+	{
+		buffers_ = static_cast< char* >( allocator_->Allocate( arg_buffers_size, arg_alignment ) );
+		bookkeeping_ = allocator_->Allocate( arg_bookkeeping_size, alignof( uint64_t ) );
+	}
+	else
+	{
+#ifndef HSA_NO_MALLOC
+		buffers_ = static_cast< char* >( AlignedMallocAllocator().Allocate( arg_buffers_size, arg_alignment ) );
+		bookkeeping_ = malloc( arg_bookkeeping_size );
+#endif // !HSA_NO_MALLOC
+	}
+	HSA_ASSERT( buffers_ && bookkeeping_ );
+	HSA_ASSERT( reinterpret_cast< size_t >( buffers_ ) % arg_alignment == 0 ); // the allocator does not support the alignment
+}
+detail::IOBufferMemory::~IOBufferMemory()
+{
+	if( allocator_ )
+	{
+		allocator_->Free( buffers_ );
+		allocator_->Free( bookkeeping_ );
+	}
+	else
+	{
+#ifndef HSA_NO_MALLOC
+		AlignedMallocAllocator().Free( buffers_ );
+		free( bookkeeping_ );
+#endif // !HSA_NO_MALLOC
+	}
+}
+template<size_t BufferSize>
+IOBufferPool<BufferSize>::Slice::Slice( IOBufferPool* arg_pool, size_t arg_index, size_t arg_offset, size_t arg_size ) :
+	pool_( arg_pool ),
+	index_( arg_index ),
+	offset_( arg_offset ),
+	size_( arg_size )
+{
+}
+template<size_t BufferSize>
+IOBufferPool<BufferSize>::Slice::Slice( const Slice& arg_other ) :
+	pool_( arg_other.pool_ ),
+	index_( arg_other.index_ ),
+	offset_( arg_other.offset_ ),
+	size_( arg_other.size_ )
+{
+	if( pool_ != nullptr )
+	{
+		pool_->ref_counts_[index_].fetch_add( 1, std::memory_order_relaxed );
+	}
+}
+template<size_t BufferSize>
+IOBufferPool<BufferSize>::Slice::Slice( Slice&& arg_other ) noexcept :
+	pool_( arg_other.pool_ ),
+	index_( arg_other.index_ ),
+	offset_( arg_other.offset_ ),
+	size_( arg_other.size_ )
+{
+	arg_other.pool_ = nullptr;
+	arg_other.size_ = 0;
+}
+template<size_t BufferSize>
+typename IOBufferPool<BufferSize>::Slice& IOBufferPool<BufferSize>::Slice::operator=( const Slice& arg_other )
+{
+	if( this != &arg_other )
+	{
+		if( arg_other.pool_ != nullptr )
+		{
+			arg_other.pool_->ref_counts_[arg_other.index_].fetch_add( 1, std::memory_order_relaxed );
+		}
+		Reset();
+		pool_ = arg_other.pool_;
+		index_ = arg_other.index_;
+		offset_ = arg_other.offset_;
+		size_ = arg_other.size_;
+	}
+	return *this;
+}
+template<size_t BufferSize>
+typename IOBufferPool<BufferSize>::Slice& IOBufferPool<BufferSize>::Slice::operator=( Slice&& arg_other ) noexcept
+{
+	if( this != &arg_other )
+	{
+		Reset();
+		pool_ = arg_other.pool_;
+		index_ = arg_other.index_;
+		offset_ = arg_other.offset_;
+		size_ = arg_other.size_;
+		arg_other.pool_ = nullptr;
+		arg_other.size_ = 0;
+	}
+	return *this;
+}
+template<size_t BufferSize>
+IOBufferPool<BufferSize>::Slice::~Slice()
+{
+	Reset();
+}
+template<size_t BufferSize>
+inline char* IOBufferPool<BufferSize>::Slice::Data() const
+{
+	if( pool_ == nullptr )
+	{
+		return nullptr;
+	}
+	return pool_->memory_.buffers_ + index_ * BufferSize + offset_;
+}
+template<size_t BufferSize>
+inline size_t IOBufferPool<BufferSize>::Slice::Size() const
+{
+	return size_;
+}
+template<size_t BufferSize>
+inline IOBufferPool<BufferSize>::Slice::operator bool() const
+{
+	return pool_ != nullptr;
+}
+template<size_t BufferSize>
+inline typename IOBufferPool<BufferSize>::Slice IOBufferPool<BufferSize>::Slice::SubSlice( size_t arg_offset, size_t arg_size ) const
+{
+	HSA_ASSERT( pool_ != nullptr && arg_offset <= size_ );
+	size_t size = arg_size < size_ - arg_offset ? arg_size : size_ - arg_offset;
+	pool_->ref_counts_[index_].fetch_add( 1, std::memory_order_relaxed );
+	return Slice( pool_, index_, offset_ + arg_offset, size );
+}
+template<size_t BufferSize>
+inline uint32_t IOBufferPool<BufferSize>::Slice::UseCount() const
+{
+	if( pool_ == nullptr )
+	{
+		return 0;
+	}
+	return pool_->ref_counts_[index_].load( std::memory_order_relaxed );
+}
+template<size_t BufferSize>
+inline void IOBufferPool<BufferSize>::Slice::Reset()
+{
+	if( pool_ != nullptr )
+	{
+		pool_->Release( index_ );
+		pool_ = nullptr;
+		size_ = 0;
+	}
+}
+template<size_t BufferSize>
+IOBufferPool<BufferSize>::IOBufferPool( size_t arg_buffer_count, Allocator* arg_allocator ) :
+	buffer_count_( ( arg_buffer_count + 7 ) / 8 * 8 ),
+	memory_( buffer_count_ * BufferSize, page_size, buffer_count_ * sizeof( std::atomic<uint32_t> ) + buffer_count_ / 8, arg_allocator ),
+	ref_counts_( static_cast< std::atomic<uint32_t>* >( memory_.bookkeeping_ ) ),
+	pool_( memory_.buffers_, static_cast< unsigned char* >( memory_.bookkeeping_ ) + buffer_count_ * sizeof( std::atomic<uint32_t> ), buffer_count_ )
+{
+	for( size_t i = 0; i < buffer_count_; i++ )
+	{
+		new( &ref_counts_[i] ) std::atomic<uint32_t>( 0 );
+	}
+}
+template<size_t BufferSize>
+inline typename IOBufferPool<BufferSize>::Slice IOBufferPool<BufferSize>::Acquire()
+{
+	char* buffer = static_cast< char* >( pool_.TryAllocate() );
+	if( buffer == nullptr )
+	{
+		return Slice();
+	}
+	size_t index = static_cast< size_t >( buffer - memory_.buffers_ ) / BufferSize;
+	ref_counts_[index].store( 1, std::memory_order_relaxed );
+	return Slice( this, index, 0, BufferSize );
+}
+template<size_t BufferSize>
+inline size_t IOBufferPool<BufferSize>::AcquireBatch( Slice* arg_slices, size_t arg_count )
+{
+	for( size_t i = 0; i < arg_count; i++ )
+	{
+		arg_slices[i] = Acquire();
+		if( !arg_slices[i] )
+		{
+			return i;
+		}
+	}
+	return arg_count;
+}
+template<size_t BufferSize>
+inline void IOBufferPool<BufferSize>::Collect()
+{
+	pool_.Collect();
+}
+template<size_t BufferSize>
+inline bool IOBufferPool<BufferSize>::Owns( const void* arg_ptr ) const
+{
+	return arg_ptr >= memory_.buffers_ && arg_ptr < memory_.buffers_ + buffer_count_ * BufferSize;
+}
+template<size_t BufferSize>
+inline size_t IOBufferPool<BufferSize>::BufferCount() const
+{
+	return buffer_count_;
+}
+template<size_t BufferSize>
+inline void IOBufferPool<BufferSize>::Release( size_t arg_index )
+{
+	// the last slice frees the buffer. frees from other threads go to the remote free list of the pool.
+	if( ref_counts_[arg_index].fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+	{
+		pool_.Free( memory_.buffers_ + arg_index * BufferSize );
+	}
+}
+#pragma endregion
+#ifndef HSA_NO_MALLOC
+#pragma region CoroutineFrameAllocatorImplementation
+detail::FrameCache::~FrameCache()
+{
+	while( slabs_ != nullptr )
+	{
+		FrameSlab* next = slabs_->next_;
+		AlignedMallocAllocator().Free( slabs_ );
+		slabs_ = next;
+	}
+}
+inline void* detail::FrameCache::Allocate( size_t arg_size )
+{
+	size_t size_class = 0;
+	while( ( min_frame_size << size_class ) < arg_size )
+	{
+		size_class++;
+	}
+	if( free_frames_[size_class] == nullptr )
+	{
+		Collect();
+		if( free_frames_[size_class] == nullptr )
+		{
+			Refill( size_class );
+		}
+	}
+	void* frame = free_frames_[size_class];
+	if( frame != nullptr )
+	{
+		free_frames_[size_class] = *reinterpret_cast< void** >( frame );
+		live_frames_++;
+	}
+	return frame;
+}
+inline void detail::FrameCache::Free( void* arg_ptr )
+{
+	FrameSlab* slab = reinterpret_cast< FrameSlab* >( reinterpret_cast< size_t >( arg_ptr ) & ~( slab_size - 1 ) );
+	if( slab->owner_ != this )
+	{
+		slab->owner_->RemoteFree( arg_ptr );
+		return;
+	}
+	*reinterpret_cast< void** >( arg_ptr ) = free_frames_[slab->size_class_];
+	free_frames_[slab->size_class_] = arg_ptr;
+	live_frames_--;
+}
+inline void detail::FrameCache::Collect()
+{
+	void* frame = remote_frees_.TakeAll();
+	while( frame != nullptr )
+	{
+		void* next = *reinterpret_cast< void** >( frame );
+		Free( frame );
+		remote_collected_++;
+		frame = next;
+	}
+}
+inline void detail::FrameCache::RemoteFree( void* arg_ptr )
+{
+	remote_frees_.Push( arg_ptr );
+	if( orphan_count_.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+	{
+		Destroy( this ); // last frame of an orphaned cache.
+	}
+}
+inline void detail::FrameCache::Orphan()
+{
+	// every remote free ever made subtracted one. adding the collected and live frames leaves the frames that are still alive.
+	size_t outstanding = live_frames_ + remote_collected_;
+	if( orphan_count_.fetch_add( outstanding, std::memory_order_acq_rel ) + outstanding == 0 )
+	{
+		Destroy( this );
+	}
+}
+inline void detail::FrameCache::Destroy( FrameCache* arg_cache )
+{
+	arg_cache->~FrameCache();
+	free( arg_cache );
+}
+inline void* detail::FrameCache::AllocateAfterExit( size_t arg_size )
+{
+	void* mem_block = malloc( sizeof( FrameCache ) );
+	if( mem_block == nullptr )
+	{
+		return nullptr;
+	}
+	FrameCache* cache = new( mem_block ) FrameCache();
+	void* frame = cache->Allocate( arg_size );
+	cache->Orphan(); // destroyed when the frame is freed, or now if there is no frame.
+	return frame;
+}
+inline void detail::FrameCache::FreeAfterExit( void* arg_ptr )
+{
+	FrameSlab* slab = reinterpret_cast< FrameSlab* >( reinterpret_cast< size_t >( arg_ptr ) & ~( slab_size - 1 ) );
+	slab->owner_->RemoteFree( arg_ptr );
+}
+inline size_t detail::FrameCache::LiveFrames() const
+{
+	return live_frames_;
+}
+inline void detail::FrameCache::Refill( size_t arg_size_class )
+{
+	// the slab is aligned to its size, a frame finds its slab by masking its address.
+	char* slab_ptr = static_cast< char* >( AlignedMallocAllocator().Allocate( slab_size, slab_size ) );
+	if( slab_ptr == nullptr )
+	{
+		return;
+	}
+	FrameSlab* slab = reinterpret_cast< FrameSlab* >( slab_ptr );
+	slab->owner_ = this;
+	slab->size_class_ = arg_size_class;
+	slab->next_ = slabs_;
+	slabs_ = slab;
+
+	size_t frame_size = min_frame_size << arg_size_class;
+	for( char* frame = slab_ptr + slab_size - frame_size; frame >= slab_ptr + slab_header_size; frame -= frame_size )
+	{
+		*reinterpret_cast< void** >( frame ) = free_frames_[arg_size_class];
+		free_frames_[arg_size_class] = frame;
+	}
+}
+namespace detail
+{
+	// plain thread locals are never destroyed, so they can still be read while other thread locals are destroyed.
+	thread_local FrameCache* thread_frame_cache = nullptr;
+	thread_local bool thread_frame_cache_exited = false;
+
+	/**
+	* @brief orphans the frame cache of a thread at thread exit so frees from other threads stay valid.
+	*/
+	struct FrameCacheHolder
+	{
+		~FrameCacheHolder()
+		{
+			FrameCache* cache = thread_frame_cache;
+			thread_frame_cache = nullptr;
+			thread_frame_cache_exited = true;
+			if( cache != nullptr )
+			{
+				cache->Collect();
+				cache->Orphan();
+			}
+		}
+	};
+	/**
+	* @brief the frame cache of the calling thread. nullptr once the cache was orphaned at thread exit.
+	*/
+	inline FrameCache* threadFrameCache()
+	{
+		if( thread_frame_cache == nullptr && !thread_frame_cache_exited )
+		{
+			thread_local FrameCacheHolder holder;
+			void* mem_block = malloc( sizeof( FrameCache ) );
+			HSA_ASSERT( mem_block )
+			thread_frame_cache = new( mem_block ) FrameCache();
+		}
+		return thread_frame_cache;
+	}
+	inline StackAllocator& threadFrameStack()
+	{
+		thread_local StackAllocator stack( CoroutineFrameStack::stack_size );
+		return stack;
+	}
+}
+inline void* CoroutineFramePool::Allocate( size_t arg_size )
+{
+	void* frame = nullptr;
+	if( arg_size <= detail::FrameCache::max_frame_size )
+	{
+		detail::FrameCache* cache = detail::threadFrameCache();
+		frame = cache != nullptr ? cache->Allocate( arg_size ) : detail::FrameCache::AllocateAfterExit( arg_size );
+	}
+	else
+	{
+		frame = malloc( arg_size );
+	}
+	HSA_ASSERT( frame != nullptr ) // out of memory
+	return frame;
+}
+inline void CoroutineFramePool::Free( void* arg_ptr, size_t arg_size )
+{
+	if( arg_size <= detail::FrameCache::max_frame_size )
+	{
+		detail::FrameCache* cache = detail::threadFrameCache();
+		if( cache != nullptr )
+		{
+			cache->Free( arg_ptr );
+		}
+		else
+		{
+			detail::FrameCache::FreeAfterExit( arg_ptr );
+		}
+	}
+	else
+	{
+		free( arg_ptr );
+	}
+}
+inline void* CoroutineFrameStack::Allocate( size_t arg_size )
+{
+	void* frame = detail::threadFrameStack().TryAllocate( arg_size, 16 );
+	if( frame == nullptr )
+	{
+		frame = malloc( arg_size );
+	}
+	HSA_ASSERT( frame != nullptr ) // out of memory
+	return frame;
+}
+inline void CoroutineFrameStack::Free( void* arg_ptr, size_t arg_size )
+{
+	HSA_UNUSED( arg_size );
+	StackAllocator& stack = detail::threadFrameStack();
+	if( stack.Owns( arg_ptr ) )
+	{
+		stack.Free( arg_ptr );
+	}
+	else
+	{
+		free( arg_ptr );
+	}
+}
+#pragma endregion
+#endif // !HSA_NO_MALLOC
+#pragma region OffsetHeapImplementation
+namespace detail
+{
+	inline size_t OffsetHeapPoolOffset()
+	{
+		return sizeof( OffsetHeap ) + calcAlignedOffset( sizeof( OffsetHeap ), 16 );
+	}
+}
+detail::OffsetHeap* detail::OffsetHeap::Create( void* arg_memory, size_t arg_size )
+{
+	HSA_ASSERT( arg_size > OffsetHeapPoolOffset() + sizeof( OffsetFreeListHeader ) ); // memory too small for a heap
+	OffsetHeap* heap = new( arg_memory ) OffsetHeap();
+	heap->magic_ = magic;
+	heap->version_ = version;
+	heap->header_size_ = static_cast< uint32_t >( sizeof( OffsetHeap ) );
+	heap->mapping_size_ = arg_size;
+	heap->pool_size_ = arg_size - OffsetHeapPoolOffset();
+	heap->pool_size_ -= heap->pool_size_ % alignof( FreeListAllocationHeader );
+	heap->Reset();
+	return heap;
+}
+bool detail::OffsetHeap::IsValid( const void* arg_memory, size_t arg_size )
+{
+	if( arg_memory == nullptr || arg_size < OffsetHeapPoolOffset() )
+	{
+		return false;
+	}
+	const OffsetHeap* heap = static_cast< const OffsetHeap* >( arg_memory );
+	return heap->magic_ == magic && heap->version_ == version && heap->header_size_ == sizeof( OffsetHeap ) &&
+		heap->mapping_size_ == arg_size && heap->pool_size_ <= arg_size - OffsetHeapPoolOffset();
+}
+inline char* detail::OffsetHeap::Pool() const
+{
+	return const_cast< char* >( reinterpret_cast< const char* >( this ) ) + OffsetHeapPoolOffset();
+}
+inline bool detail::OffsetHeap::Contains( const void* arg_ptr ) const
+{
+	const char* char_ptr = static_cast< const char* >( arg_ptr );
+	return char_ptr >= Pool() && char_ptr < Pool() + pool_size_;
+}
+inline void* detail::OffsetHeap::Allocate( size_t arg_size, size_t arg_alignment )
+{
+	// same block layout as the FreeListAllocator. every block start stays aligned for the allocation header.
+	arg_size += calcAlignedOffset( arg_size, alignof( FreeListAllocationHeader ) );
+
+	OffsetPtr<OffsetFreeListHeader>* link = &free_list_;
+	while( *link )
+	{
+		OffsetFreeListHeader* block = link->Get();
+		char* raw_ptr = reinterpret_cast< char* >( block );
+		size_t aligned_offset = calcAlignedOffset( reinterpret_cast< size_t >( raw_ptr ) + sizeof( FreeListAllocationHeader ), arg_alignment );
+		while( aligned_offset != 0 && aligned_offset < sizeof( size_t ) )
+		{
+			aligned_offset += arg_alignment; // padding has to be able to hold its own size.
+		}
+		size_t total_aligned_size = arg_size + sizeof( FreeListAllocationHeader ) + aligned_offset;
+
+		if( block->size_ >= total_aligned_size )
+		{
+			OffsetFreeListHeader* next = block->next_.Get();
+			size_t block_size = block->size_;
+			if( block_size >= total_aligned_size + sizeof( FreeListAllocationHeader ) + FreeList::minimum_header_size ) // split block.
+			{
+				OffsetFreeListHeader* remainder = new( raw_ptr + total_aligned_size ) OffsetFreeListHeader();
+				remainder->next_ = next;
+				remainder->size_ = block_size - total_aligned_size;
+				*link = remainder;
+			}
+			else
+			{
+				*link = next;
+				arg_size += block_size - total_aligned_size; // add remainder to the size so it does not get lost.
+			}
+
+			if( aligned_offset != 0 )
+			{
+				*reinterpret_cast< size_t* >( raw_ptr ) = aligned_offset; // lets Walk() find the allocation header.
+			}
+			raw_ptr += aligned_offset;
+			FreeListAllocationHeader* alloc_header = reinterpret_cast< FreeListAllocationHeader* >( raw_ptr );
+			alloc_header->adjustment_ = aligned_offset;
+			alloc_header->size_ = arg_size;
+			return raw_ptr + sizeof( FreeListAllocationHeader );
+		}
+		link = &block->next_;
+	}
+	HSA_ASSERT( false ); // out of memory
+	return nullptr;
+}
+inline void detail::OffsetHeap::Free( void* arg_ptr )
+{
+	HSA_ASSERT( Contains( arg_ptr ) ); // Deallocating outside of heap memory
+	char* raw_ptr = static_cast< char* >( arg_ptr ) - sizeof( FreeListAllocationHeader );
+	FreeListAllocationHeader* alloc_header = reinterpret_cast< FreeListAllocationHeader* >( raw_ptr );
+	size_t block_size = alloc_header->size_ + alloc_header->adjustment_ + sizeof( FreeListAllocationHeader );
+	raw_ptr -= alloc_header->adjustment_;
+
+	// find the free blocks around the freed block.
+	OffsetFreeListHeader* previous = nullptr;
+	OffsetPtr<OffsetFreeListHeader>* link = &free_list_;
+	while( *link && reinterpret_cast< char* >( link->Get() ) < raw_ptr )
+	{
+		previous = link->Get();
+		link = &previous->next_;
+	}
+	OffsetFreeListHeader* next = link->Get();
+
+	OffsetFreeListHeader* block = new( raw_ptr ) OffsetFreeListHeader();
+	block->size_ = block_size;
+	if( next != nullptr && raw_ptr + block_size == reinterpret_cast< char* >( next ) )
+	{
+		block->size_ += next->size_;
+		block->next_ = next->next_.Get();
+	}
+	else
+	{
+		block->next_ = next;
+	}
+
+	if( previous != nullptr && reinterpret_cast< char* >( previous ) + previous->size_ == raw_ptr )
+	{
+		previous->size_ += block->size_;
+		previous->next_ = block->next_.Get();
+	}
+	else
+	{
+		*link = block;
+	}
+}
+inline void detail::OffsetHeap::Reset()
+{
+	OffsetFreeListHeader* block = new( Pool() ) OffsetFreeListHeader();
+	block->size_ = pool_size_;
+	free_list_ = block;
+	for( size_t i = 0; i < root_count; i++ )
+	{
+		roots_[i] = nullptr;
+	}
+}
+inline void detail::OffsetHeap::Walk( HeapWalkCallback arg_callback, void* arg_user_data ) const
+{
+	const OffsetFreeListHeader* free_block = free_list_.Get();
+	char* block_ptr = Pool();
+	char* pool_end = Pool() + pool_size_;
+	while( block_ptr < pool_end )
+	{
+		HeapBlock block;
+		block.offset_ = block_ptr - Pool();
+		if( reinterpret_cast< const char* >( free_block ) == block_ptr )
+		{
+			block.size_ = free_block->size_;
+			block.padding_ = 0;
+			block.header_size_ = 0;
+			block.is_free_ = true;
+			free_block = free_block->next_.Get();
+		}
+		else
+		{
+			size_t padding = *reinterpret_cast< size_t* >( block_ptr );
+			auto* alloc_header = reinterpret_cast< FreeListAllocationHeader* >( block_ptr + padding );
+			HSA_ASSERT( alloc_header->adjustment_ == padding ); // corrupted heap
+			block.size_ = padding + sizeof( FreeListAllocationHeader ) + alloc_header->size_;
+			block.padding_ = padding;
+			block.header_size_ = sizeof( FreeListAllocationHeader );
+			block.is_free_ = false;
+		}
+		arg_callback( block, arg_user_data );
+		block_ptr += block.size_;
+	}
+}
+#pragma endregion
+#pragma region PersistentFreeListAllocatorImplementation
+#ifdef HSA_POSIX
+PersistentFreeListAllocator::PersistentFreeListAllocator( const char* arg_path, size_t arg_size )
+{
+	file_ = open( arg_path, O_RDWR | O_CREAT, 0644 );
+	HSA_ASSERT( file_ != -1 ); // cannot open file
+	if( file_ == -1 )
+	{
+		return;
+	}
+
+	struct stat file_stat;
+	mapping_size_ = fstat( file_, &file_stat ) == 0 ? static_cast< size_t >( file_stat.st_size ) : 0;
+	void* mapping = MAP_FAILED;
+	if( mapping_size_ > 0 )
+	{
+		mapping = mmap( nullptr, mapping_size_, PROT_READ | PROT_WRITE, MAP_SHARED, file_, 0 );
+		is_warm_start_ = mapping != MAP_FAILED && detail::OffsetHeap::IsValid( mapping, mapping_size_ );
+		if( is_warm_start_ == false )
+		{
+			// never overwrite a file that has other data or a heap of another version.
+			HSA_ASSERT( false ); // file is not empty and does not contain a valid heap
+			if( mapping != MAP_FAILED )
+			{
+				munmap( mapping, mapping_size_ );
+			}
+			close( file_ );
+			file_ = -1;
+			return;
+		}
+	}
+
+	if( is_warm_start_ == false )
+	{
+		mapping_size_ = arg_size;
+		mapping = MAP_FAILED;
+		if( ftruncate( file_, static_cast< off_t >( mapping_size_ ) ) == 0 )
+		{
+			mapping = mmap( nullptr, mapping_size_, PROT_READ | PROT_WRITE, MAP_SHARED, file_, 0 );
+		}
+		HSA_ASSERT( mapping != MAP_FAILED ); // cannot map file
+		if( mapping == MAP_FAILED )
+		{
+			return;
+		}
+		heap_ = detail::OffsetHeap::Create( mapping, mapping_size_ );
+	}
+	else
+	{
+		heap_ = static_cast< detail::OffsetHeap* >( mapping );
+	}
+}
+PersistentFreeListAllocator::~PersistentFreeListAllocator()
+{
+	if( heap_ )
+	{
+		munmap( heap_, mapping_size_ );
+	}
+	if( file_ != -1 )
+	{
+		close( file_ );
+	}
+}
+inline void* PersistentFreeListAllocator::Allocate( size_t arg_size, size_t arg_alignment )
+{
+	return heap_->Allocate( arg_size, arg_alignment );
+}
+inline void PersistentFreeListAllocator::Free( void* arg_ptr )
+{
+	heap_->Free( arg_ptr );
+}
+inline void PersistentFreeListAllocator::Reset()
+{
+	heap_->Reset();
+}
+inline void PersistentFreeListAllocator::Walk( HeapWalkCallback arg_callback, void* arg_user_data ) const
+{
+	heap_->Walk( arg_callback, arg_user_data );
+}
+inline void PersistentFreeListAllocator::SetRoot( size_t arg_index, void* arg_ptr )
+{
+	HSA_ASSERT( arg_index < root_count );
+	HSA_ASSERT( arg_ptr == nullptr || heap_->Contains( arg_ptr ) ); // roots have to point into the heap
+	heap_->roots_[arg_index] = arg_ptr;
+}
+inline void* PersistentFreeListAllocator::GetRoot( size_t arg_index ) const
+{
+	HSA_ASSERT( arg_index < root_count );
+	return heap_->roots_[arg_index].Get();
+}
+inline void PersistentFreeListAllocator::Flush()
+{
+	msync( heap_, mapping_size_, MS_SYNC );
+}
+inline bool PersistentFreeListAllocator::IsWarmStart() const
+{
+	return is_warm_start_;
+}
+inline bool PersistentFreeListAllocator::IsOpen() const
+{
+	return heap_ != nullptr;
+}
+#endif // HSA_POSIX
+#pragma endregion
+#pragma region SharedMemoryAllocatorImplementation
+#ifdef HSA_POSIX
+namespace detail
+{
+	struct SharedHeapHeader
+	{
+		static const uint32_t ready = 0x52454459; // "READY"
+		static const uint32_t broken = 0x42524B4E; // "BRKN"
+
+		pthread_mutex_t mutex_;
+		std::atomic<uint32_t> state_;
+	};
+	inline size_t SharedHeapOffset()
+	{
+		return sizeof( SharedHeapHeader ) + calcAlignedOffset( sizeof( SharedHeapHeader ), 16 );
+	}
+	/**
+	* @brief locks a shared heap for the lifetime of the object.
+	*/
+	class SharedHeapLock
+	{
+	public:
+		SharedHeapLock( SharedHeapHeader* arg_header ) :
+			header_( arg_header )
+		{
+			int result = pthread_mutex_lock( &header_->mutex_ );
+#ifdef __linux__
+			if( result == EOWNERDEAD )
+			{
+				// a process died while holding the lock, maybe in the middle of changing the free list.
+				// the mutex can be used again but the heap stays broken until it is reset.
+				header_->state_.store( SharedHeapHeader::broken, std::memory_order_relaxed );
+				pthread_mutex_consistent( &header_->mutex_ );
+				result = 0;
+			}
+#endif // __linux__
+			HSA_ASSERT( result == 0 );
+			locked_ = result == 0;
+		}
+		~SharedHeapLock()
+		{
+			if( locked_ )
+			{
+				pthread_mutex_unlock( &header_->mutex_ );
+			}
+		}
+		bool IsLocked() const
+		{
+			return locked_;
+		}
+		/**
+		* @brief true if the lock is held and the heap is not broken.
+		*/
+		bool IsHeapUsable() const
+		{
+			return locked_ && header_->state_.load( std::memory_order_relaxed ) == SharedHeapHeader::ready;
+		}
+	private:
+		SharedHeapHeader* header_;
+		bool locked_ = false;
+	};
+	/**
+	* @brief waits until the creator of a segment finished a step.
+	* @return false when the deadline passed first.
+	*/
+	template<class Function>
+	bool sharedHeapWait( std::chrono::steady_clock::time_point arg_deadline, Function arg_is_done )
+	{
+		while( !arg_is_done() )
+		{
+			if( std::chrono::steady_clock::now() > arg_deadline )
+			{
+				return false;
+			}
+			std::this_thread::yield();
+		}
+		return true;
+	}
+}
+SharedMemoryAllocator::SharedMemoryAllocator( const char* arg_name, size_t arg_size )
+{
+	// opening processes give up when the creator takes longer than open_timeout_ms.
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds( static_cast< int64_t >( open_timeout_ms ) );
+
+	int shared_file = shm_open( arg_name, O_RDWR | O_CREAT | O_EXCL, 0600 );
+	is_creator_ = shared_file != -1;
+	if( is_creator_ )
+	{
+		mapping_size_ = arg_size;
+		if( ftruncate( shared_file, static_cast< off_t >( mapping_size_ ) ) != 0 )
+		{
+			HSA_ASSERT( false ); // cannot resize segment
+			close( shared_file );
+			shm_unlink( arg_name ); // other processes would wait for a segment that is never resized.
+			return;
+		}
+	}
+	else
+	{
+		shared_file = shm_open( arg_name, O_RDWR, 0600 );
+		HSA_ASSERT( shared_file != -1 ); // cannot open segment
+		if( shared_file == -1 )
+		{
+			return;
+		}
+		// the creator might not have resized the segment yet.
+		struct stat file_stat;
+		bool is_resized = detail::sharedHeapWait( deadline, [&]
+		{
+			mapping_size_ = fstat( shared_file, &file_stat ) == 0 ? static_cast< size_t >( file_stat.st_size ) : 0;
+			return mapping_size_ != 0;
+		} );
+		if( !is_resized )
+		{
+			HSA_ASSERT( false ); // the creator did not resize the segment in time
+			close( shared_file );
+			return;
+		}
+	}
+
+	void* mapping = mmap( nullptr, mapping_size_, PROT_READ | PROT_WRITE, MAP_SHARED, shared_file, 0 );
+	close( shared_file );
+	HSA_ASSERT( mapping != MAP_FAILED ); // cannot map segment
+	if( mapping == MAP_FAILED )
+	{
+		if( is_creator_ )
+		{
+			shm_unlink( arg_name );
+		}
+		return;
+	}
+
+	shared_header_ = static_cast< detail::SharedHeapHeader* >( mapping );
+	if( is_creator_ )
+	{
+		shared_header_->state_.store( 0, std::memory_order_relaxed );
+		pthread_mutexattr_t mutex_attributes;
+		pthread_mutexattr_init( &mutex_attributes );
+		pthread_mutexattr_setpshared( &mutex_attributes, PTHREAD_PROCESS_SHARED );
+#ifdef __linux__
+		pthread_mutexattr_setrobust( &mutex_attributes, PTHREAD_MUTEX_ROBUST );
+#endif // __linux__
+		pthread_mutex_init( &shared_header_->mutex_, &mutex_attributes );
+		pthread_mutexattr_destroy( &mutex_attributes );
+
+		heap_ = detail::OffsetHeap::Create( static_cast< char* >( mapping ) + detail::SharedHeapOffset(), mapping_size_ - detail::SharedHeapOffset() );
+		shared_header_->state_.store( detail::SharedHeapHeader::ready, std::memory_order_release );
+	}
+	else
+	{
+		// wait for the creator to finish initializing. a broken heap was initialized and can be reset.
+		bool is_ready = detail::sharedHeapWait( deadline, [this]
+		{
+			uint32_t state = shared_header_->state_.load( std::memory_order_acquire );
+			return state == detail::SharedHeapHeader::ready || state == detail::SharedHeapHeader::broken;
+		} );
+		if( !is_ready )
+		{
+			HSA_ASSERT( false ); // the creator did not initialize the segment in time
+			munmap( mapping, mapping_size_ );
+			shared_header_ = nullptr;
+			return;
+		}
+		heap_ = reinterpret_cast< detail::OffsetHeap* >( static_cast< char* >( mapping ) + detail::SharedHeapOffset() );
+	}
+}
+SharedMemoryAllocator::~SharedMemoryAllocator()
+{
+	if( shared_header_ )
+	{
+		munmap( shared_header_, mapping_size_ );
+	}
+}
+void SharedMemoryAllocator::Unlink( const char* arg_name )
+{
+	shm_unlink( arg_name );
+}
+inline void* SharedMemoryAllocator::Allocate( size_t arg_size, size_t arg_alignment )
+{
+	detail::SharedHeapLock lock( shared_header_ );
+	if( !lock.IsHeapUsable() )
+	{
+		HSA_ASSERT( false ) // heap is broken, a process died while it changed the heap
+		return nullptr;
+	}
+	return heap_->Allocate( arg_size, arg_alignment );
+}
+inline void SharedMemoryAllocator::Free( void* arg_ptr )
+{
+	detail::SharedHeapLock lock( shared_header_ );
+	if( !lock.IsHeapUsable() )
+	{
+		HSA_ASSERT( false ) // heap is broken, a process died while it changed the heap
+		return;
+	}
+	heap_->Free( arg_ptr );
+}
+inline void SharedMemoryAllocator::Reset()
+{
+	detail::SharedHeapLock lock( shared_header_ );
+	if( lock.IsLocked() )
+	{
+		heap_->Reset();
+		shared_header_->state_.store( detail::SharedHeapHeader::ready, std::memory_order_release );
+	}
+}
+inline void SharedMemoryAllocator::Walk( HeapWalkCallback arg_callback, void* arg_user_data )
+{
+	detail::SharedHeapLock lock( shared_header_ );
+	if( !lock.IsHeapUsable() )
+	{
+		HSA_ASSERT( false ) // heap is broken, a process died while it changed the heap
+		return;
+	}
+	heap_->Walk( arg_callback, arg_user_data );
+}
+inline size_t SharedMemoryAllocator::ToOffset( const void* arg_ptr ) const
+{
+	if( arg_ptr == nullptr )
+	{
+		return 0;
+	}
+	HSA_ASSERT( heap_->Contains( arg_ptr ) ); // pointer is not in the segment
+	return static_cast< const char* >( arg_ptr ) - reinterpret_cast< const char* >( shared_header_ );
+}
+inline void* SharedMemoryAllocator::FromOffset( size_t arg_offset ) const
+{
+	if( arg_offset == 0 )
+	{
+		return nullptr;
+	}
+	HSA_ASSERT( arg_offset < mapping_size_ ); // offset is not in the segment
+	return reinterpret_cast< char* >( shared_header_ ) + arg_offset;
+}
+inline void SharedMemoryAllocator::SetRoot( size_t arg_index, void* arg_ptr )
+{
+	HSA_ASSERT( arg_index < root_count );
+	HSA_ASSERT( arg_ptr == nullptr || heap_->Contains( arg_ptr ) ); // roots have to point into the heap
+	detail::SharedHeapLock lock( shared_header_ );
+	if( lock.IsHeapUsable() )
+	{
+		heap_->roots_[arg_index] = arg_ptr;
+	}
+}
+inline void* SharedMemoryAllocator::GetRoot( size_t arg_index )
+{
+	HSA_ASSERT( arg_index < root_count );
+	detail::SharedHeapLock lock( shared_header_ );
+	return lock.IsHeapUsable() ? heap_->roots_[arg_index].Get() : nullptr;
+}
+inline bool SharedMemoryAllocator::IsCreator() const
+{
+	return is_creator_;
+}
+inline bool SharedMemoryAllocator::IsOpen() const
+{
+	return heap_ != nullptr;
+}
+inline bool SharedMemoryAllocator::IsBroken() const
+{
+	return shared_header_ != nullptr && shared_header_->state_.load( std::memory_order_acquire ) == detail::SharedHeapHeader::broken;
+}
+#endif // HSA_POSIX
+#pragma endregion
+#pragma region HeapWalkReportImplementation
+HeapWalkReport::HeapWalkReport( size_t arg_pool_size, size_t arg_map_cells ) :
+	pool_size_( arg_pool_size ),
+	map_cells_( arg_map_cells < max_map_cells ? arg_map_cells : max_map_cells )
+{
+	HSA_ASSERT( map_cells_ > 0 );
+}
+void HeapWalkReport::Collect( const HeapBlock& arg_block, void* arg_report )
+{
+	static_cast< HeapWalkReport* >( arg_report )->Add( arg_block );
+}
+void HeapWalkReport::Add( const HeapBlock& arg_block )
+{
+	size_t bucket = 0;
+	while( ( arg_block.size_ >> ( bucket + 1 ) ) != 0 && bucket + 1 < histogram_bucket_count )
+	{
+		++bucket;
+	}
+
+	if( arg_block.is_free_ )
+	{
+		free_bytes_ += arg_block.size_;
+		++free_block_count_;
+		++free_histogram_[bucket];
+		if( arg_block.size_ > largest_free_block_ )
+		{
+			largest_free_block_ = arg_block.size_;
+		}
+		return;
+	}
+
+	live_bytes_ += arg_block.size_;
+	overhead_bytes_ += arg_block.padding_ + arg_block.header_size_;
+	++live_block_count_;
+	++live_histogram_[bucket];
+
+	// spread the block over the cells it touches.
+	if( pool_size_ == 0 )
+	{
+		return;
+	}
+	size_t block_start = arg_block.offset_;
+	size_t block_end = arg_block.offset_ + arg_block.size_;
+	while( block_start < block_end && block_start < pool_size_ )
+	{
+		size_t cell = static_cast< size_t >( ( static_cast< double >( block_start ) / pool_size_ ) * map_cells_ );
+		size_t cell_end = static_cast< size_t >( ( static_cast< double >( cell + 1 ) / map_cells_ ) * pool_size_ );
+		if( cell_end <= block_start )
+		{
+			cell_end = block_start + 1;
+		}
+		size_t part_end = block_end < cell_end ? block_end : cell_end;
+		cell_used_bytes_[cell < map_cells_ ? cell : map_cells_ - 1] += part_end - block_start;
+		block_start = part_end;
+	}
+}
+float HeapWalkReport::Fragmentation() const
+{
+	if( free_bytes_ == 0 )
+	{
+		return 0.0f;
+	}
+	return 1.0f - static_cast< float >( largest_free_block_ ) / static_cast< float >( free_bytes_ );
+}
+size_t HeapWalkReport::WriteFragmentationMap( char* arg_buffer, size_t arg_buffer_size ) const
+{
+	HSA_ASSERT( arg_buffer_size > 0 );
+	size_t written = 0;
+	for( size_t cell = 0; cell < map_cells_ && written + 1 < arg_buffer_size; cell++ )
+	{
+		size_t cell_start = static_cast< size_t >( ( static_cast< double >( cell ) / map_cells_ ) * pool_size_ );
+		size_t cell_end = static_cast< size_t >( ( static_cast< double >( cell + 1 ) / map_cells_ ) * pool_size_ );
+		size_t cell_size = cell_end > cell_start ? cell_end - cell_start : 1;
+		size_t used = cell_used_bytes_[cell];
+
+		char cell_char = '.';
+		if( used >= cell_size )
+		{
+			cell_char = '#';
+		}
+		else if( used * 2 > cell_size )
+		{
+			cell_char = '+';
+		}
+		else if( used > 0 )
+		{
+			cell_char = '-';
+		}
+		arg_buffer[written++] = cell_char;
+	}
+	arg_buffer[written] = '\0';
+	return written;
+}
+#pragma endregion
+#pragma region LatencyHistogramImplementation
+LatencyHistogram::LatencyHistogram()
+{
+	Reset();
+}
+LatencyHistogram::LatencyHistogram( const LatencyHistogram& arg_other )
+{
+	Reset();
+	Merge( arg_other );
 }
-void AlignedMallocAllocator::Free( void* arg_ptr )
+LatencyHistogram& LatencyHistogram::operator=( const LatencyHistogram& arg_other )
 {
-	_aligned_free( arg_ptr );
+	if( this != &arg_other )
+	{
+		Reset();
+		Merge( arg_other );
+	}
+	return *this;
+}
+inline void LatencyHistogram::Record( uint64_t arg_value )
+{
+	buckets_[BucketOf( arg_value )].fetch_add( 1, std::memory_order_relaxed );
+	sum_.fetch_add( arg_value, std::memory_order_relaxed );
+	uint64_t max = max_.load( std::memory_order_relaxed );
+	while( arg_value > max && !max_.compare_exchange_weak( max, arg_value, std::memory_order_relaxed ) )
+	{
+	}
+}
+void LatencyHistogram::Merge( const LatencyHistogram& arg_other )
+{
+	for( size_t i = 0; i < bucket_count; i++ )
+	{
+		uint64_t count = arg_other.buckets_[i].load( std::memory_order_relaxed );
+		if( count != 0 )
+		{
+			buckets_[i].fetch_add( count, std::memory_order_relaxed );
+		}
+	}
+	sum_.fetch_add( arg_other.sum_.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+	uint64_t other_max = arg_other.max_.load( std::memory_order_relaxed );
+	uint64_t max = max_.load( std::memory_order_relaxed );
+	while( other_max > max && !max_.compare_exchange_weak( max, other_max, std::memory_order_relaxed ) )
+	{
+	}
+}
+void LatencyHistogram::Reset()
+{
+	for( size_t i = 0; i < bucket_count; i++ )
+	{
+		buckets_[i].store( 0, std::memory_order_relaxed );
+	}
+	sum_.store( 0, std::memory_order_relaxed );
+	max_.store( 0, std::memory_order_relaxed );
+}
+uint64_t LatencyHistogram::Count() const
+{
+	uint64_t count = 0;
+	for( size_t i = 0; i < bucket_count; i++ )
+	{
+		count += buckets_[i].load( std::memory_order_relaxed );
+	}
+	return count;
+}
+uint64_t LatencyHistogram::Max() const
+{
+	return max_.load( std::memory_order_relaxed );
+}
+double LatencyHistogram::Mean() const
+{
+	uint64_t count = Count();
+	if( count == 0 )
+	{
+		return 0.0;
+	}
+	return static_cast< double >( sum_.load( std::memory_order_relaxed ) ) / static_cast< double >( count );
+}
+uint64_t LatencyHistogram::ValueAtPercentile( double arg_percentile ) const
+{
+	uint64_t count = Count();
+	if( count == 0 )
+	{
+		return 0;
+	}
+	double percentile = arg_percentile < 0.0 ? 0.0 : ( arg_percentile > 100.0 ? 100.0 : arg_percentile );
+	uint64_t target = static_cast< uint64_t >( percentile / 100.0 * static_cast< double >( count ) + 0.5 );
+	if( target == 0 )
+	{
+		target = 1;
+	}
+	uint64_t max = Max();
+	uint64_t seen = 0;
+	for( size_t i = 0; i < bucket_count; i++ )
+	{
+		seen += buckets_[i].load( std::memory_order_relaxed );
+		if( seen >= target )
+		{
+			uint64_t value = BucketMaxValue( i );
+			return value < max ? value : max; // the highest bucket is never above the highest value.
+		}
+	}
+	return max;
+}
+size_t LatencyHistogram::Write( char* arg_buffer, size_t arg_buffer_size ) const
+{
+	HSA_ASSERT( arg_buffer_size > 0 );
+	size_t written = 0;
+	detail::addWritten( snprintf( arg_buffer, arg_buffer_size, "count %llu mean %.1f max %llu\n",
+		static_cast< unsigned long long >( Count() ), Mean(), static_cast< unsigned long long >( Max() ) ), arg_buffer_size, written );
+	detail::addWritten( snprintf( arg_buffer + written, arg_buffer_size - written, "p50 %llu p90 %llu p99 %llu p99.9 %llu p99.99 %llu\n",
+		static_cast< unsigned long long >( ValueAtPercentile( 50.0 ) ), static_cast< unsigned long long >( ValueAtPercentile( 90.0 ) ),
+		static_cast< unsigned long long >( ValueAtPercentile( 99.0 ) ), static_cast< unsigned long long >( ValueAtPercentile( 99.9 ) ),
+		static_cast< unsigned long long >( ValueAtPercentile( 99.99 ) ) ), arg_buffer_size, written );
+	for( size_t i = 0; i < bucket_count && written + 1 < arg_buffer_size; i++ )
+	{
+		uint64_t count = buckets_[i].load( std::memory_order_relaxed );
+		if( count != 0 )
+		{
+			detail::addWritten( snprintf( arg_buffer + written, arg_buffer_size - written, "%llu\t%llu\n",
+				static_cast< unsigned long long >( BucketMaxValue( i ) ), static_cast< unsigned long long >( count ) ), arg_buffer_size, written );
+		}
+	}
+	return written;
+}
+uint64_t LatencyHistogram::BucketCount( size_t arg_bucket ) const
+{
+	HSA_ASSERT( arg_bucket < bucket_count );
+	return buckets_[arg_bucket].load( std::memory_order_relaxed );
+}
+inline size_t LatencyHistogram::BucketOf( uint64_t arg_value )
+{
+	if( arg_value < sub_bucket_count )
+	{
+		return static_cast< size_t >( arg_value );
+	}
+	size_t shift = detail::highestBit( arg_value ) - sub_bucket_bits;
+	return ( shift + 1 ) * sub_bucket_count + static_cast< size_t >( ( arg_value >> shift ) & ( sub_bucket_count - 1 ) );
+}
+uint64_t LatencyHistogram::BucketMaxValue( size_t arg_bucket )
+{
+	if( arg_bucket < sub_bucket_count )
+	{
+		return arg_bucket;
+	}
+	size_t shift = arg_bucket / sub_bucket_count - 1;
+	uint64_t lowest = static_cast< uint64_t >( sub_bucket_count + arg_bucket % sub_bucket_count ) << shift;
+	return lowest + ( ( uint64_t( 1 ) << shift ) - 1 );
 }
-#endif // HSA_NO_MALLOC
 #pragma endregion
-#pragma region LinearAllocatorImplementation
-LinearAllocator::LinearAllocator()
+#ifndef HSA_NO_MALLOC
+#pragma region LatencyTrackingAllocatorImplementation
+detail::LatencyShards::~LatencyShards()
+{
+	for( size_t i = 0; i < max_shards; i++ )
+	{
+		Shard* shard = shards_[i].load( std::memory_order_relaxed );
+		if( shard != nullptr )
+		{
+			shard->~Shard();
+			std::free( shard );
+		}
+	}
+}
+inline detail::LatencyShards::Shard* detail::LatencyShards::LocalShard()
+{
+	static std::atomic<size_t> thread_count = { 0 };
+	static thread_local size_t shard_index = thread_count.fetch_add( 1, std::memory_order_relaxed ) % max_shards;
+
+	Shard* shard = shards_[shard_index].load( std::memory_order_acquire );
+	if( shard != nullptr )
+	{
+		return shard;
+	}
+	void* memory = std::malloc( sizeof( Shard ) );
+	if( memory == nullptr )
+	{
+		return nullptr; // the latency is not recorded.
+	}
+	Shard* new_shard = new( memory ) Shard();
+	if( !shards_[shard_index].compare_exchange_strong( shard, new_shard, std::memory_order_acq_rel, std::memory_order_acquire ) )
+	{
+		// another thread with the same shard index was faster.
+		new_shard->~Shard();
+		std::free( new_shard );
+		return shard;
+	}
+	return new_shard;
+}
+inline void detail::LatencyShards::RecordAllocate( uint64_t arg_latency )
+{
+	Shard* shard = LocalShard();
+	if( shard != nullptr )
+	{
+		shard->allocate_.Record( arg_latency );
+	}
+}
+inline void detail::LatencyShards::RecordFree( uint64_t arg_latency )
+{
+	Shard* shard = LocalShard();
+	if( shard != nullptr )
+	{
+		shard->free_.Record( arg_latency );
+	}
+}
+inline void detail::LatencyShards::MergeAllocate( LatencyHistogram& arg_histogram ) const
+{
+	for( size_t i = 0; i < max_shards; i++ )
+	{
+		Shard* shard = shards_[i].load( std::memory_order_acquire );
+		if( shard != nullptr )
+		{
+			arg_histogram.Merge( shard->allocate_ );
+		}
+	}
+}
+inline void detail::LatencyShards::MergeFree( LatencyHistogram& arg_histogram ) const
+{
+	for( size_t i = 0; i < max_shards; i++ )
+	{
+		Shard* shard = shards_[i].load( std::memory_order_acquire );
+		if( shard != nullptr )
+		{
+			arg_histogram.Merge( shard->free_ );
+		}
+	}
+}
+inline void detail::LatencyShards::Reset()
+{
+	for( size_t i = 0; i < max_shards; i++ )
+	{
+		Shard* shard = shards_[i].load( std::memory_order_acquire );
+		if( shard != nullptr )
+		{
+			shard->allocate_.Reset();
+			shard->free_.Reset();
+		}
+	}
+}
+template<class PoolType>
+template<class... Args>
+LatencyTrackingAllocator<PoolType>::LatencyTrackingAllocator( Args&&... arg_args ) :
+	pool_( std::forward<Args>( arg_args )... )
+{
+}
+template<class PoolType>
+inline void* LatencyTrackingAllocator<PoolType>::Allocate( size_t arg_size, size_t arg_alignment )
+{
+	uint64_t start = detail::latencyTimestamp();
+	void* ptr = pool_.Allocate( arg_size, arg_alignment );
+	latency_.RecordAllocate( detail::latencyTimestamp() - start );
+	return ptr;
+}
+template<class PoolType>
+inline void* LatencyTrackingAllocator<PoolType>::TryAllocate( size_t arg_size, size_t arg_alignment )
+{
+	uint64_t start = detail::latencyTimestamp();
+	void* ptr = pool_.TryAllocate( arg_size, arg_alignment );
+	latency_.RecordAllocate( detail::latencyTimestamp() - start );
+	return ptr;
+}
+template<class PoolType>
+inline void LatencyTrackingAllocator<PoolType>::Free( void* arg_ptr )
+{
+	uint64_t start = detail::latencyTimestamp();
+	pool_.Free( arg_ptr );
+	latency_.RecordFree( detail::latencyTimestamp() - start );
+}
+template<class PoolType>
+inline bool LatencyTrackingAllocator<PoolType>::TryExpand( void* arg_ptr, size_t arg_size, size_t arg_new_size )
+{
+	uint64_t start = detail::latencyTimestamp();
+	bool expanded = pool_.TryExpand( arg_ptr, arg_size, arg_new_size );
+	latency_.RecordAllocate( detail::latencyTimestamp() - start );
+	return expanded;
+}
+template<class PoolType>
+inline void LatencyTrackingAllocator<PoolType>::FreeSized( void* arg_ptr, size_t arg_size )
+{
+	uint64_t start = detail::latencyTimestamp();
+	pool_.FreeSized( arg_ptr, arg_size );
+	latency_.RecordFree( detail::latencyTimestamp() - start );
+}
+template<class PoolType>
+inline LatencyHistogram LatencyTrackingAllocator<PoolType>::AllocateLatency() const
+{
+	LatencyHistogram histogram;
+	latency_.MergeAllocate( histogram );
+	return histogram;
+}
+template<class PoolType>
+inline LatencyHistogram LatencyTrackingAllocator<PoolType>::FreeLatency() const
+{
+	LatencyHistogram histogram;
+	latency_.MergeFree( histogram );
+	return histogram;
+}
+template<class PoolType>
+inline void LatencyTrackingAllocator<PoolType>::ResetLatency()
+{
+	latency_.Reset();
+}
+template<class PoolType>
+inline PoolType& LatencyTrackingAllocator<PoolType>::Pool()
+{
+	return pool_;
+}
+template<size_t ChunkSize>
+template<class... Args>
+LatencyTrackingAllocator<BitmapAllocator<ChunkSize>>::LatencyTrackingAllocator( Args&&... arg_args ) :
+	pool_( std::forward<Args>( arg_args )... )
+{
+}
+template<size_t ChunkSize>
+inline void* LatencyTrackingAllocator<BitmapAllocator<ChunkSize>>::Allocate()
+{
+	uint64_t start = detail::latencyTimestamp();
+	void* ptr = pool_.Allocate();
+	latency_.RecordAllocate( detail::latencyTimestamp() - start );
+	return ptr;
+}
+template<size_t ChunkSize>
+inline void* LatencyTrackingAllocator<BitmapAllocator<ChunkSize>>::TryAllocate()
+{
+	uint64_t start = detail::latencyTimestamp();
+	void* ptr = pool_.TryAllocate();
+	latency_.RecordAllocate( detail::latencyTimestamp() - start );
+	return ptr;
+}
+template<size_t ChunkSize>
+inline void LatencyTrackingAllocator<BitmapAllocator<ChunkSize>>::Free( void* arg_ptr )
+{
+	uint64_t start = detail::latencyTimestamp();
+	pool_.Free( arg_ptr );
+	latency_.RecordFree( detail::latencyTimestamp() - start );
+}
+template<size_t ChunkSize>
+inline LatencyHistogram LatencyTrackingAllocator<BitmapAllocator<ChunkSize>>::AllocateLatency() const
+{
+	LatencyHistogram histogram;
+	latency_.MergeAllocate( histogram );
+	return histogram;
+}
+template<size_t ChunkSize>
+inline LatencyHistogram LatencyTrackingAllocator<BitmapAllocator<ChunkSize>>::FreeLatency() const
+{
+	LatencyHistogram histogram;
+	latency_.MergeFree( histogram );
+	return histogram;
+}
+template<size_t ChunkSize>
+inline void LatencyTrackingAllocator<BitmapAllocator<ChunkSize>>::ResetLatency()
+{
+	latency_.Reset();
+}
+template<size_t ChunkSize>
+inline BitmapAllocator<ChunkSize>& LatencyTrackingAllocator<BitmapAllocator<ChunkSize>>::Pool()
+{
+	return pool_;
+}
+#pragma endregion
+#endif // !HSA_NO_MALLOC
+#ifndef HSA_NO_MALLOC
+#pragma region HeapProfilerImplementation
+namespace detail
+{
+	/**
+	* @brief writes the return addresses of the calling function and its callers.
+	* @param skip frames of the calling function and its callers that are not written.
+	* @return amount of frames written
+	*/
+	HSA_NOINLINE size_t captureBacktrace( void** arg_frames, size_t arg_max_frames, size_t arg_skip )
+	{
+		const size_t max_capture = 64;
+		void* frames[max_capture];
+		size_t capture = arg_max_frames + arg_skip + 1 < max_capture ? arg_max_frames + arg_skip + 1 : max_capture;
+		size_t count = 0;
+#if __GLIBC__ || __APPLE__
+		int captured = backtrace( frames, static_cast< int >( capture ) );
+		count = captured > 0 ? static_cast< size_t >( captured ) : 0;
+#elif _WIN32
+		count = RtlCaptureStackBackTrace( 0, static_cast< unsigned long >( capture ), frames, nullptr );
+#else
+		HSA_UNUSED( capture );
+#endif
+		size_t skip = arg_skip + 1; // this function
+		size_t written = 0;
+		for( size_t i = skip; i < count && written < arg_max_frames; i++ )
+		{
+			arg_frames[written++] = frames[i];
+		}
+		return written;
+	}
+}
+HeapProfiler::HeapProfiler( Allocator* arg_allocator, size_t arg_sample_interval ) :
+	allocator_( arg_allocator ),
+	random_state_( reinterpret_cast< uintptr_t >( this ) ^ detail::latencyTimestamp() ^ 0x9E3779B97F4A7C15ull )
+{
+	SetSampleInterval( arg_sample_interval );
+}
+HeapProfiler::~HeapProfiler()
+{
+	std::free( samples_ );
+}
+// the backtrace is captured here and not in a helper. a helper can be inlined or called as a tail call,
+// then a fixed amount of skipped frames would also skip the caller.
+void* HeapProfiler::Allocate( size_t arg_size, size_t arg_alignment )
+{
+	void* ptr = allocator_ != nullptr ? allocator_->Allocate( arg_size, arg_alignment ) : AlignedMallocAllocator().Allocate( arg_size, arg_alignment );
+	if( ptr != nullptr && SampleDue( arg_size ) )
+	{
+		void* frames[HeapSample::max_frames];
+		size_t frame_count = detail::captureBacktrace( frames, HeapSample::max_frames, 1 ); // Allocate()
+		Sample( ptr, arg_size, frames, frame_count );
+	}
+	return ptr;
+}
+void* HeapProfiler::TryAllocate( size_t arg_size, size_t arg_alignment )
+{
+	void* ptr = allocator_ != nullptr ? allocator_->TryAllocate( arg_size, arg_alignment ) : AlignedMallocAllocator().Allocate( arg_size, arg_alignment );
+	if( ptr != nullptr && SampleDue( arg_size ) )
+	{
+		void* frames[HeapSample::max_frames];
+		size_t frame_count = detail::captureBacktrace( frames, HeapSample::max_frames, 1 ); // TryAllocate()
+		Sample( ptr, arg_size, frames, frame_count );
+	}
+	return ptr;
+}
+void HeapProfiler::Free( void* arg_ptr )
+{
+	if( sample_count_ != 0 && arg_ptr != nullptr )
+	{
+		RemoveSample( arg_ptr );
+	}
+	if( allocator_ != nullptr )
+	{
+		allocator_->Free( arg_ptr );
+		return;
+	}
+	AlignedMallocAllocator().Free( arg_ptr );
+}
+bool HeapProfiler::TryExpand( void* arg_ptr, size_t arg_size, size_t arg_new_size )
+{
+	return allocator_ != nullptr && allocator_->TryExpand( arg_ptr, arg_size, arg_new_size );
+}
+void HeapProfiler::FreeSized( void* arg_ptr, size_t arg_size )
+{
+	if( sample_count_ != 0 && arg_ptr != nullptr )
+	{
+		RemoveSample( arg_ptr );
+	}
+	if( allocator_ != nullptr )
+	{
+		allocator_->FreeSized( arg_ptr, arg_size );
+		return;
+	}
+	AlignedMallocAllocator().Free( arg_ptr );
+}
+void HeapProfiler::SetSampleInterval( size_t arg_sample_interval )
+{
+	sample_interval_ = arg_sample_interval;
+	bytes_until_sample_ = static_cast< int64_t >( NextSampleDistance() );
+}
+size_t HeapProfiler::SampleInterval() const
+{
+	return sample_interval_;
+}
+size_t HeapProfiler::LiveSampleCount() const
+{
+	return sample_count_;
+}
+size_t HeapProfiler::EstimatedLiveBytes() const
+{
+	return sampled_bytes_;
+}
+void HeapProfiler::Walk( HeapSampleCallback arg_callback, void* arg_user_data ) const
+{
+	for( size_t i = 0; i < capacity_; i++ )
+	{
+		if( samples_[i].ptr_ != nullptr )
+		{
+			arg_callback( samples_[i], arg_user_data );
+		}
+	}
+}
+size_t HeapProfiler::WriteFoldedStacks( char* arg_buffer, size_t arg_buffer_size ) const
+{
+	HSA_ASSERT( arg_buffer_size > 0 );
+	arg_buffer[0] = '\0';
+	if( sample_count_ == 0 )
+	{
+		return 0;
+	}
+	const HeapSample** sorted = static_cast< const HeapSample** >( std::malloc( sample_count_ * sizeof( const HeapSample* ) ) );
+	if( sorted == nullptr )
+	{
+		HSA_ASSERT( false ); // out of memory
+		return 0;
+	}
+	size_t count = 0;
+	for( size_t i = 0; i < capacity_; i++ )
+	{
+		if( samples_[i].ptr_ != nullptr )
+		{
+			sorted[count++] = &samples_[i];
+		}
+	}
+	// samples with the same call stack end up next to each other.
+	std::sort( sorted, sorted + count, []( const HeapSample* arg_lhs, const HeapSample* arg_rhs )
+	{
+		if( arg_lhs->frame_count_ != arg_rhs->frame_count_ )
+		{
+			return arg_lhs->frame_count_ < arg_rhs->frame_count_;
+		}
+		return std::memcmp( arg_lhs->frames_, arg_rhs->frames_, arg_lhs->frame_count_ * sizeof( void* ) ) < 0;
+	} );
+
+	size_t written = 0;
+	size_t i = 0;
+	while( i < count && written + 1 < arg_buffer_size )
+	{
+		const HeapSample* sample = sorted[i];
+		size_t bytes = 0;
+		while( i < count && sorted[i]->frame_count_ == sample->frame_count_ &&
+			std::memcmp( sorted[i]->frames_, sample->frames_, sample->frame_count_ * sizeof( void* ) ) == 0 )
+		{
+			bytes += sorted[i]->weight_;
+			++i;
+		}
+		if( sample->frame_count_ == 0 )
+		{
+			detail::addWritten( snprintf( arg_buffer + written, arg_buffer_size - written, "[unknown]" ), arg_buffer_size, written );
+		}
+		for( size_t frame = sample->frame_count_; frame > 0; frame-- )
+		{
+			detail::addWritten( snprintf( arg_buffer + written, arg_buffer_size - written, frame == sample->frame_count_ ? "0x%llx" : ";0x%llx",
+				static_cast< unsigned long long >( reinterpret_cast< uintptr_t >( sample->frames_[frame - 1] ) ) ), arg_buffer_size, written );
+		}
+		detail::addWritten( snprintf( arg_buffer + written, arg_buffer_size - written, " %zu\n", bytes ), arg_buffer_size, written );
+	}
+	std::free( sorted );
+	return written;
+}
+bool HeapProfiler::SampleDue( size_t arg_size )
+{
+	bytes_until_sample_ -= static_cast< int64_t >( arg_size );
+	if( bytes_until_sample_ >= 0 )
+	{
+		return false;
+	}
+	bytes_until_sample_ = static_cast< int64_t >( NextSampleDistance() );
+	return true;
+}
+void HeapProfiler::Sample( void* arg_ptr, size_t arg_size, void* const* arg_frames, size_t arg_frame_count )
+{
+	if( ( sample_count_ + 1 ) * 2 > capacity_ && !GrowTable() )
+	{
+		return; // the sample is lost.
+	}
+	size_t mask = capacity_ - 1;
+	size_t slot = SlotOf( arg_ptr );
+	while( samples_[slot].ptr_ != nullptr )
+	{
+		slot = ( slot + 1 ) & mask;
+	}
+	HeapSample& sample = samples_[slot];
+	sample.ptr_ = arg_ptr;
+	sample.size_ = arg_size;
+	// a sample stands for all bytes that were allocated since the previous sample.
+	// bigger allocations are more likely to be sampled, so their weight is corrected by that probability.
+	if( sample_interval_ == 0 )
+	{
+		sample.weight_ = arg_size;
+	}
+	else
+	{
+		double size = static_cast< double >( arg_size );
+		double probability = 1.0 - std::exp( -size / static_cast< double >( sample_interval_ ) );
+		sample.weight_ = static_cast< size_t >( size / probability + 0.5 );
+	}
+	sample.frame_count_ = arg_frame_count;
+	memcpy( sample.frames_, arg_frames, arg_frame_count * sizeof( void* ) );
+	++sample_count_;
+	sampled_bytes_ += sample.weight_;
+}
+void HeapProfiler::RemoveSample( void* arg_ptr )
+{
+	size_t mask = capacity_ - 1;
+	size_t slot = SlotOf( arg_ptr );
+	while( samples_[slot].ptr_ != arg_ptr )
+	{
+		if( samples_[slot].ptr_ == nullptr )
+		{
+			return; // not sampled
+		}
+		slot = ( slot + 1 ) & mask;
+	}
+	sampled_bytes_ -= samples_[slot].weight_;
+	--sample_count_;
+
+	// move samples after the hole back so every sample can still be found from its home slot.
+	size_t hole = slot;
+	size_t next = ( hole + 1 ) & mask;
+	while( samples_[next].ptr_ != nullptr )
+	{
+		size_t home = SlotOf( samples_[next].ptr_ );
+		if( ( ( next - home ) & mask ) >= ( ( next - hole ) & mask ) )
+		{
+			samples_[hole] = samples_[next];
+			hole = next;
+		}
+		next = ( next + 1 ) & mask;
+	}
+	samples_[hole].ptr_ = nullptr;
+}
+bool HeapProfiler::GrowTable()
+{
+	size_t new_capacity = capacity_ == 0 ? 64 : capacity_ * 2;
+	HeapSample* new_samples = static_cast< HeapSample* >( std::malloc( new_capacity * sizeof( HeapSample ) ) );
+	if( new_samples == nullptr )
+	{
+		return false;
+	}
+	for( size_t i = 0; i < new_capacity; i++ )
+	{
+		new_samples[i].ptr_ = nullptr;
+	}
+	HeapSample* old_samples = samples_;
+	size_t old_capacity = capacity_;
+	samples_ = new_samples;
+	capacity_ = new_capacity;
+	size_t mask = capacity_ - 1;
+	for( size_t i = 0; i < old_capacity; i++ )
+	{
+		if( old_samples[i].ptr_ != nullptr )
+		{
+			size_t slot = SlotOf( old_samples[i].ptr_ );
+			while( samples_[slot].ptr_ != nullptr )
+			{
+				slot = ( slot + 1 ) & mask;
+			}
+			samples_[slot] = old_samples[i];
+		}
+	}
+	std::free( old_samples );
+	return true;
+}
+size_t HeapProfiler::NextSampleDistance()
+{
+	if( sample_interval_ == 0 )
+	{
+		return 0;
+	}
+	// exponential distribution, the distance between two points of a poisson process.
+	random_state_ ^= random_state_ >> 12;
+	random_state_ ^= random_state_ << 25;
+	random_state_ ^= random_state_ >> 27;
+	uint64_t random = random_state_ * 0x2545F4914F6CDD1Dull;
+	double uniform = static_cast< double >( ( random >> 11 ) + 1 ) * ( 1.0 / 9007199254740992.0 ); // (0, 1]
+	return static_cast< size_t >( -std::log( uniform ) * static_cast< double >( sample_interval_ ) );
+}
+size_t HeapProfiler::SlotOf( const void* arg_ptr ) const
 {
-#ifndef HSA_NO_MALLOC
-	mem_pool_ = static_cast< char* >( malloc( pool_size_ = MIBI( 50 ) ) );
-#endif // !HSA_NO_MALLOC
-
-		HSA_ASSERT( mem_pool_ )
+	uint64_t hash = static_cast< uint64_t >( reinterpret_cast< uintptr_t >( arg_ptr ) ) * 0x9E3779B97F4A7C15ull;
+	return static_cast< size_t >( hash >> 32 ) & ( capacity_ - 1 );
 }
-LinearAllocator::LinearAllocator( size_t arg_size, Allocator* arg_allocator ) :
-	allocator_( arg_allocator )
+#pragma endregion
+#endif // !HSA_NO_MALLOC
+#ifndef HSA_NO_MALLOC
+#pragma region PageMapImplementation
+namespace detail
 {
-	if( arg_allocator )
+	static_assert( PageMap::page_shift + 3 * PageMap::level_bits == PageMap::address_bits, "three levels cover the address space" );
+	const size_t page_map_level_size = size_t( 1 ) << PageMap::level_bits;
+	const uintptr_t page_map_list_tag = 1; // set when a page entry points to a PageMapNode list instead of a range.
+
+	struct PageMapLeaf
 	{
-		mem_pool_ = static_cast< char* >( arg_allocator->Allocate( pool_size_ = arg_size, 16 ) );
+		std::atomic<uintptr_t> entries_[page_map_level_size];
+	};
+	struct PageMapMid
+	{
+		std::atomic<PageMapLeaf*> leaves_[page_map_level_size];
+	};
+
+	std::atomic<PageMapMid*> page_map_root[page_map_level_size];
+	std::atomic_flag page_map_lock = ATOMIC_FLAG_INIT;
+	std::atomic<uint64_t> page_map_version( 0 ); // odd while the page map is changed.
+	// ranges and nodes are reused instead of freed, a lock free lookup can still be reading them.
+	PageMapRange* page_map_free_ranges = nullptr;
+	PageMapNode* page_map_free_nodes = nullptr;
+
+	class PageMapLock
+	{
+	public:
+		PageMapLock()
+		{
+			while( page_map_lock.test_and_set( std::memory_order_acquire ) )
+			{
+				std::this_thread::yield();
+			}
+			page_map_version.store( page_map_version.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+			std::atomic_thread_fence( std::memory_order_release );
+		}
+		~PageMapLock()
+		{
+			page_map_version.store( page_map_version.load( std::memory_order_relaxed ) + 1, std::memory_order_release );
+			page_map_lock.clear( std::memory_order_release );
+		}
+	};
+
+	inline std::atomic<uintptr_t>* pageMapEntry( uint64_t arg_page, bool arg_create )
+	{
+		std::atomic<PageMapMid*>& root_entry = page_map_root[arg_page >> ( 2 * PageMap::level_bits )];
+		PageMapMid* mid = root_entry.load( std::memory_order_acquire );
+		if( mid == nullptr )
+		{
+			void* memory = arg_create ? malloc( sizeof( PageMapMid ) ) : nullptr;
+			if( memory == nullptr )
+			{
+				return nullptr;
+			}
+			mid = new( memory ) PageMapMid();
+			root_entry.store( mid, std::memory_order_release );
+		}
+		std::atomic<PageMapLeaf*>& mid_entry = mid->leaves_[( arg_page >> PageMap::level_bits ) & ( page_map_level_size - 1 )];
+		PageMapLeaf* leaf = mid_entry.load( std::memory_order_acquire );
+		if( leaf == nullptr )
+		{
+			void* memory = arg_create ? malloc( sizeof( PageMapLeaf ) ) : nullptr;
+			if( memory == nullptr )
+			{
+				return nullptr;
+			}
+			leaf = new( memory ) PageMapLeaf();
+			mid_entry.store( leaf, std::memory_order_release );
+		}
+		return &leaf->entries_[arg_page & ( page_map_level_size - 1 )];
 	}
-	else
+	inline PageMapNode* pageMapNewNode( PageMapRange* arg_range, PageMapNode* arg_next )
 	{
-#ifndef HSA_NO_MALLOC
-		mem_pool_ = static_cast< char* >( malloc( pool_size_ = arg_size ) );
-#endif
+		PageMapNode* node = page_map_free_nodes;
+		if( node != nullptr )
+		{
+			page_map_free_nodes = node->next_.load( std::memory_order_relaxed );
+		}
+		else
+		{
+			void* memory = malloc( sizeof( PageMapNode ) );
+			if( memory == nullptr )
+			{
+				return nullptr;
+			}
+			node = new( memory ) PageMapNode();
+		}
+		node->range_.store( arg_range, std::memory_order_relaxed );
+		node->next_.store( arg_next, std::memory_order_relaxed );
+		return node;
+	}
+	inline void pageMapRecycleNode( PageMapNode* arg_node )
+	{
+		arg_node->next_.store( page_map_free_nodes, std::memory_order_relaxed );
+		page_map_free_nodes = arg_node;
+	}
+	/**
+	* @brief removes a range from the pages [first page, end page).
+	*/
+	inline void pageMapRemove( PageMapRange* arg_range, uint64_t arg_first_page, uint64_t arg_end_page )
+	{
+		for( uint64_t page = arg_first_page; page < arg_end_page; page++ )
+		{
+			std::atomic<uintptr_t>* entry = pageMapEntry( page, false );
+			if( entry == nullptr )
+			{
+				continue;
+			}
+			uintptr_t value = entry->load( std::memory_order_relaxed );
+			if( ( value & page_map_list_tag ) == 0 )
+			{
+				if( value == reinterpret_cast< uintptr_t >( arg_range ) )
+				{
+					entry->store( 0, std::memory_order_release );
+				}
+				continue;
+			}
+			PageMapNode* head = reinterpret_cast< PageMapNode* >( value & ~page_map_list_tag );
+			PageMapNode* previous = nullptr;
+			PageMapNode* node = head;
+			while( node != nullptr && node->range_.load( std::memory_order_relaxed ) != arg_range )
+			{
+				previous = node;
+				node = node->next_.load( std::memory_order_relaxed );
+			}
+			if( node == nullptr )
+			{
+				continue;
+			}
+			PageMapNode* next = node->next_.load( std::memory_order_relaxed );
+			if( previous == nullptr )
+			{
+				head = next;
+			}
+			else
+			{
+				previous->next_.store( next, std::memory_order_release );
+			}
+			// a list with one range left goes back to a direct entry.
+			if( head->next_.load( std::memory_order_relaxed ) == nullptr )
+			{
+				entry->store( reinterpret_cast< uintptr_t >( head->range_.load( std::memory_order_relaxed ) ), std::memory_order_release );
+				pageMapRecycleNode( head );
+			}
+			else
+			{
+				entry->store( reinterpret_cast< uintptr_t >( head ) | page_map_list_tag, std::memory_order_release );
+			}
+			pageMapRecycleNode( node );
+		}
+	}
+	/**
+	* @brief looks up the owner of a pointer without the lock. the caller checks that the version did not change.
+	*/
+	inline Allocator* pageMapFind( uint64_t arg_page, const char* arg_ptr, uint64_t arg_version )
+	{
+		PageMapMid* mid = page_map_root[arg_page >> ( 2 * PageMap::level_bits )].load( std::memory_order_acquire );
+		if( mid == nullptr )
+		{
+			return nullptr;
+		}
+		PageMapLeaf* leaf = mid->leaves_[( arg_page >> PageMap::level_bits ) & ( page_map_level_size - 1 )].load( std::memory_order_acquire );
+		if( leaf == nullptr )
+		{
+			return nullptr;
+		}
+		uintptr_t value = leaf->entries_[arg_page & ( page_map_level_size - 1 )].load( std::memory_order_acquire );
+		if( ( value & page_map_list_tag ) == 0 )
+		{
+			const PageMapRange* range = reinterpret_cast< const PageMapRange* >( value );
+			return range != nullptr && arg_ptr >= range->begin_.load( std::memory_order_relaxed ) && arg_ptr < range->end_.load( std::memory_order_relaxed ) ?
+				range->owner_.load( std::memory_order_relaxed ) : nullptr;
+		}
+		// a node that is reused during the walk can lead into the list of another page, stop as soon as the version changes.
+		for( const PageMapNode* node = reinterpret_cast< const PageMapNode* >( value & ~page_map_list_tag );
+			node != nullptr && page_map_version.load( std::memory_order_relaxed ) == arg_version; node = node->next_.load( std::memory_order_acquire ) )
+		{
+			const PageMapRange* range = node->range_.load( std::memory_order_acquire );
+			if( range != nullptr && arg_ptr >= range->begin_.load( std::memory_order_relaxed ) && arg_ptr < range->end_.load( std::memory_order_relaxed ) )
+			{
+				return range->owner_.load( std::memory_order_relaxed );
+			}
+		}
+		return nullptr;
 	}
-	HSA_ASSERT( mem_pool_ )
 }
-LinearAllocator::~LinearAllocator()
+bool PageMap::Register( Allocator* arg_owner, void* arg_begin, size_t arg_size )
 {
-	if( allocator_ )
+	HSA_ASSERT( arg_size > 0 );
+	uint64_t begin = static_cast< uint64_t >( reinterpret_cast< uintptr_t >( arg_begin ) );
+	uint64_t first_page = begin >> page_shift;
+	uint64_t end_page = ( begin + arg_size - 1 ) / ( uint64_t( 1 ) << page_shift ) + 1;
+	HSA_ASSERT( ( ( end_page - 1 ) >> ( 3 * level_bits ) ) == 0 ); // address does not fit in 48 bits
+
+	detail::PageMapLock lock;
+	detail::PageMapRange* range = detail::page_map_free_ranges;
+	if( range != nullptr )
 	{
-		allocator_->Free( mem_pool_ );
+		detail::page_map_free_ranges = range->next_free_;
 	}
 	else
 	{
-#ifndef HSA_NO_MALLOC
-		free( mem_pool_ );
-#endif // !HSA_NO_MALLOC
+		void* memory = malloc( sizeof( detail::PageMapRange ) );
+		if( memory == nullptr )
+		{
+			return false;
+		}
+		range = new( memory ) detail::PageMapRange();
+	}
+	range->begin_.store( static_cast< const char* >( arg_begin ), std::memory_order_relaxed );
+	range->end_.store( static_cast< const char* >( arg_begin ) + arg_size, std::memory_order_relaxed );
+	range->owner_.store( arg_owner, std::memory_order_relaxed );
+	range->next_free_ = nullptr;
+
+	for( uint64_t page = first_page; page < end_page; page++ )
+	{
+		std::atomic<uintptr_t>* entry = detail::pageMapEntry( page, true );
+		uintptr_t value = entry != nullptr ? entry->load( std::memory_order_relaxed ) : 0;
+		uintptr_t new_value = reinterpret_cast< uintptr_t >( range );
+		if( entry != nullptr && value != 0 )
+		{
+			// the page is shared. the newest range goes to the front of the list.
+			detail::PageMapNode* next = reinterpret_cast< detail::PageMapNode* >( value & ~detail::page_map_list_tag );
+			if( ( value & detail::page_map_list_tag ) == 0 )
+			{
+				next = detail::pageMapNewNode( reinterpret_cast< detail::PageMapRange* >( value ), nullptr );
+			}
+			detail::PageMapNode* node = next != nullptr ? detail::pageMapNewNode( range, next ) : nullptr;
+			if( node == nullptr && next != nullptr && ( value & detail::page_map_list_tag ) == 0 )
+			{
+				detail::pageMapRecycleNode( next );
+			}
+			new_value = node != nullptr ? reinterpret_cast< uintptr_t >( node ) | detail::page_map_list_tag : 0;
+		}
+		if( entry == nullptr || new_value == 0 )
+		{
+			detail::pageMapRemove( range, first_page, page );
+			range->next_free_ = detail::page_map_free_ranges;
+			detail::page_map_free_ranges = range;
+			return false;
+		}
+		entry->store( new_value, std::memory_order_release );
 	}
+	return true;
 }
-inline void* LinearAllocator::Allocate( size_t arg_size, size_t arg_alignment )
+void PageMap::Unregister( Allocator* arg_owner, const void* arg_begin )
 {
-	void* ret_ptr = nullptr;
-	size_t aligned_offset = detail::calcAlignedOffset( current_offset_, arg_alignment );
+	uint64_t first_page = static_cast< uint64_t >( reinterpret_cast< uintptr_t >( arg_begin ) ) >> page_shift;
+	detail::PageMapLock lock;
+	std::atomic<uintptr_t>* entry = detail::pageMapEntry( first_page, false );
+	uintptr_t value = entry != nullptr ? entry->load( std::memory_order_relaxed ) : 0;
 
-	if( current_offset_ + aligned_offset + arg_size <= pool_size_ )
+	// the first page of the range knows the range.
+	detail::PageMapRange* range = nullptr;
+	if( ( value & detail::page_map_list_tag ) == 0 )
 	{
-		current_offset_ += aligned_offset;
-		ret_ptr = mem_pool_ + current_offset_;
-		current_offset_ += arg_size;
+		range = reinterpret_cast< detail::PageMapRange* >( value );
 	}
 	else
 	{
-		HSA_ASSERT( false ) // out of memory
+		for( detail::PageMapNode* node = reinterpret_cast< detail::PageMapNode* >( value & ~detail::page_map_list_tag ); node != nullptr; node = node->next_.load( std::memory_order_relaxed ) )
+		{
+			detail::PageMapRange* node_range = node->range_.load( std::memory_order_relaxed );
+			if( node_range->owner_.load( std::memory_order_relaxed ) == arg_owner && node_range->begin_.load( std::memory_order_relaxed ) == arg_begin )
+			{
+				range = node_range;
+				break;
+			}
+		}
+	}
+	if( range == nullptr || range->owner_.load( std::memory_order_relaxed ) != arg_owner || range->begin_.load( std::memory_order_relaxed ) != arg_begin )
+	{
+		HSA_ASSERT( false ) // range was not registered
+		return;
 	}
-	return ret_ptr;
+	uint64_t end_page = ( static_cast< uint64_t >( reinterpret_cast< uintptr_t >( range->end_.load( std::memory_order_relaxed ) ) ) - 1 ) / ( uint64_t( 1 ) << page_shift ) + 1;
+	detail::pageMapRemove( range, first_page, end_page );
+	range->next_free_ = detail::page_map_free_ranges;
+	detail::page_map_free_ranges = range;
 }
-inline void LinearAllocator::Free( void* arg_ptr )
+inline Allocator* PageMap::OwnerOf( const void* arg_ptr )
 {
-	HSA_UNUSED( arg_ptr );
-	HSA_ASSERT(false) //you cannot free memory with a linear allocator
+	uint64_t page = static_cast< uint64_t >( reinterpret_cast< uintptr_t >( arg_ptr ) ) >> page_shift;
+	if( ( page >> ( 3 * level_bits ) ) != 0 )
+	{
+		return nullptr;
+	}
+	for( ;; )
+	{
+		uint64_t version = detail::page_map_version.load( std::memory_order_acquire );
+		if( ( version & 1 ) != 0 )
+		{
+			std::this_thread::yield(); // a Register() or Unregister() is running.
+			continue;
+		}
+		Allocator* owner = detail::pageMapFind( page, static_cast< const char* >( arg_ptr ), version );
+		std::atomic_thread_fence( std::memory_order_acquire );
+		if( detail::page_map_version.load( std::memory_order_relaxed ) == version )
+		{
+			return owner;
+		}
+	}
 }
-inline void LinearAllocator::Reset()
+inline bool PageMap::Owns( const Allocator* arg_allocator, const void* arg_ptr )
 {
-	current_offset_ = 0;
+	return arg_allocator != nullptr && OwnerOf( arg_ptr ) == arg_allocator;
 }
-#pragma endregion
-#pragma region StackAllocatorImplementation
-StackAllocator::StackAllocator()
+inline bool PageMap::Free( void* arg_ptr )
 {
-#ifndef HSA_NO_MALLOC
-	mem_pool_ = static_cast< char* >( malloc( pool_size_ = MIBI( 50 ) ) );
-#endif
-	HSA_ASSERT( mem_pool_ )
-
+	if( arg_ptr == nullptr )
+	{
+		return true;
+	}
+	Allocator* owner = OwnerOf( arg_ptr );
+	if( owner == nullptr )
+	{
+		HSA_ASSERT( false ) // pointer is not part of a registered pool
+		return false;
+	}
+	owner->Free( arg_ptr );
+	return true;
 }
-StackAllocator::StackAllocator( size_t arg_size, Allocator* arg_allocator ) :
+#pragma endregion
+#endif // !HSA_NO_MALLOC
+#pragma region VectorImplementation
+template<class T>
+Vector<T>::Vector( Allocator* arg_allocator, size_t arg_capacity ) :
 	allocator_( arg_allocator )
 {
-	if( arg_allocator )
-	{
-		mem_pool_ = static_cast< char* >( arg_allocator->Allocate( pool_size_ = arg_size, 16 ) );
-	}
-	else
+	HSA_ASSERT( allocator_ != nullptr );
+	if( arg_capacity != 0 )
 	{
-#ifndef HSA_NO_MALLOC
-		mem_pool_ = static_cast< char* >( malloc( pool_size_ = arg_size ) );
-#endif
+		Reallocate( arg_capacity );
 	}
-	HSA_ASSERT( mem_pool_ )
 }
-StackAllocator::~StackAllocator()
+template<class T>
+Vector<T>::Vector( Vector&& arg_other ) noexcept :
+	allocator_( arg_other.allocator_ ),
+	data_( arg_other.data_ ),
+	size_( arg_other.size_ ),
+	capacity_( arg_other.capacity_ )
 {
-	if( allocator_ )
+	arg_other.data_ = nullptr;
+	arg_other.size_ = 0;
+	arg_other.capacity_ = 0;
+}
+template<class T>
+Vector<T>& Vector<T>::operator=( Vector&& arg_other ) noexcept
+{
+	if( this != &arg_other )
 	{
-		allocator_->Free( mem_pool_ );
+		this->~Vector();
+		new( this ) Vector( std::move( arg_other ) );
 	}
-	else
+	return *this;
+}
+template<class T>
+Vector<T>::~Vector()
+{
+	Clear();
+	if( data_ != nullptr )
 	{
-#ifndef HSA_NO_MALLOC
-		free( mem_pool_ );
-#endif // !HSA_NO_MALLOC
+		allocator_->FreeSized( data_, capacity_ * sizeof( T ) );
 	}
 }
-
-inline void* StackAllocator::Allocate( size_t arg_size, size_t arg_alignment )
+template<class T>
+inline bool Vector<T>::PushBack( const T& arg_value )
 {
-	void* return_ptr = nullptr;
-	size_t aligned_offset = detail::calcAlignedOffset( current_offset_ + sizeof(detail::StackHeader), arg_alignment );
-
-	if( current_offset_ + aligned_offset + sizeof( detail::StackHeader ) + arg_size <= pool_size_ )
+	if( size_ == capacity_ )
 	{
-		detail::StackHeader* header_ptr = reinterpret_cast< detail::StackHeader* >( mem_pool_ + current_offset_  + aligned_offset);
-		header_ptr->is_free_ = false;
-		header_ptr->previous_header_ = last_allocated_header;
-		last_allocated_header = header_ptr;
-		return_ptr = mem_pool_ + current_offset_ + aligned_offset + sizeof( detail::StackHeader );
-		current_offset_ += arg_size + aligned_offset + sizeof( detail::StackHeader );
+		T copy( arg_value ); // the value may be an element of this vector.
+		return EmplaceBack( std::move( copy ) ) != nullptr;
 	}
-	else
+	new( data_ + size_ ) T( arg_value );
+	++size_;
+	return true;
+}
+template<class T>
+inline bool Vector<T>::PushBack( T&& arg_value )
+{
+	return EmplaceBack( std::move( arg_value ) ) != nullptr;
+}
+template<class T>
+template<class... Args>
+inline T* Vector<T>::EmplaceBack( Args&&... arg_args )
+{
+	if( size_ == capacity_ && !Grow( size_ + 1 ) )
 	{
-		HSA_ASSERT( false ) // out of memory
+		return nullptr;
 	}
-
-	return return_ptr;
+	T* element = new( data_ + size_ ) T( std::forward<Args>( arg_args )... );
+	++size_;
+	return element;
 }
-inline void StackAllocator::Free( void* arg_ptr )
+template<class T>
+inline void Vector<T>::PopBack()
 {
-	if( last_allocated_header == nullptr )
+	HSA_ASSERT( size_ > 0 );
+	data_[--size_].~T();
+}
+template<class T>
+inline bool Vector<T>::Reserve( size_t arg_capacity )
+{
+	return arg_capacity <= capacity_ || Reallocate( arg_capacity );
+}
+template<class T>
+inline bool Vector<T>::Resize( size_t arg_size )
+{
+	if( arg_size > capacity_ && !Grow( arg_size ) )
 	{
-		HSA_ASSERT( false ) //deallocation but never allocated
+		return false;
 	}
-	if( arg_ptr < mem_pool_ + sizeof( detail::StackHeader ) && arg_ptr > mem_pool_ + pool_size_ )
+	for( ; size_ < arg_size; ++size_ )
 	{
-		HSA_ASSERT( false ) //Deallocating outside of Allocator memory
+		new( data_ + size_ ) T();
 	}
-
-	char* arg_char_ptr = reinterpret_cast< char* >( arg_ptr );
-	detail::StackHeader* header_ptr = reinterpret_cast< detail::StackHeader* >( arg_char_ptr - sizeof( header_ptr ) );
-	header_ptr->is_free_ = true;
-	if( header_ptr == last_allocated_header )
+	while( size_ > arg_size )
 	{
-		detail::StackHeader* temp_header_ptr = header_ptr;
-		bool continue_looping = true;
-		do
-		{
-			if( temp_header_ptr->previous_header_ != nullptr )
-			{
-				if( temp_header_ptr->previous_header_->is_free_ )
-				{
-					temp_header_ptr = temp_header_ptr->previous_header_;
-				}
-				else
-				{
-					continue_looping = false;
-					char* temp_ptr = reinterpret_cast< char* >( temp_header_ptr );
-					current_offset_ = temp_ptr - mem_pool_;
-					last_allocated_header = temp_header_ptr->previous_header_;
-				}
-			}
-			else
-			{
-				continue_looping = false;
-				current_offset_ = 0;
-				last_allocated_header = nullptr;
-			}
-		} while( continue_looping );
+		data_[--size_].~T();
 	}
+	return true;
 }
-inline void StackAllocator::Reset()
+template<class T>
+inline void Vector<T>::Clear()
 {
-	current_offset_ = 0;
-	last_allocated_header = nullptr;
+	while( size_ > 0 )
+	{
+		data_[--size_].~T();
+	}
 }
-#pragma endregion
-#pragma region BitmapAllocatorImplementation
-template <size_t ChunkSize>
-BitmapAllocator<ChunkSize>::BitmapAllocator()
+template<class T>
+inline T& Vector<T>::operator[]( size_t arg_index )
+{
+	HSA_ASSERT( arg_index < size_ );
+	return data_[arg_index];
+}
+template<class T>
+inline const T& Vector<T>::operator[]( size_t arg_index ) const
+{
+	HSA_ASSERT( arg_index < size_ );
+	return data_[arg_index];
+}
+template<class T>
+inline T& Vector<T>::Back()
+{
+	HSA_ASSERT( size_ > 0 );
+	return data_[size_ - 1];
+}
+template<class T>
+inline T* Vector<T>::Data()
+{
+	return data_;
+}
+template<class T>
+inline const T* Vector<T>::Data() const
+{
+	return data_;
+}
+template<class T>
+inline size_t Vector<T>::Size() const
+{
+	return size_;
+}
+template<class T>
+inline size_t Vector<T>::Capacity() const
+{
+	return capacity_;
+}
+template<class T>
+inline bool Vector<T>::Empty() const
+{
+	return size_ == 0;
+}
+template<class T>
+inline T* Vector<T>::begin()
+{
+	return data_;
+}
+template<class T>
+inline T* Vector<T>::end()
+{
+	return data_ + size_;
+}
+template<class T>
+inline const T* Vector<T>::begin() const
+{
+	return data_;
+}
+template<class T>
+inline const T* Vector<T>::end() const
+{
+	return data_ + size_;
+}
+template<class T>
+inline bool Vector<T>::Grow( size_t arg_min_capacity )
 {
-#ifndef HSA_NO_MALLOC
-	bitmap_ = static_cast< unsigned char* >( malloc( 64 * sizeof( char ) ) ); //allocate bitmap
-	mem_pool_ = static_cast< detail::bitmapChunk<ChunkSize>* >( malloc( 512 * ChunkSize ) );
-#endif
-	HSA_ASSERT( mem_pool_ )
-	chunk_size_ = ChunkSize;
-	chunk_count_ = 512;
-	for( size_t i = 0; i < 64; i++ )
-	{
-		bitmap_[i] = 0;
-	}
+	const size_t max_capacity = SIZE_MAX / sizeof( T );
+	size_t capacity = capacity_ < 4 ? 4 : capacity_;
+	capacity = capacity <= max_capacity / 2 ? capacity * 2 : max_capacity;
+	return Reallocate( capacity > arg_min_capacity ? capacity : arg_min_capacity );
 }
-template <size_t ChunkSize>
-BitmapAllocator<ChunkSize>::BitmapAllocator( size_t arg_chunk_count, Allocator* arg_allocator ) :
-	allocator_( arg_allocator )
+template<class T>
+inline bool Vector<T>::Reallocate( size_t arg_capacity )
 {
-	size_t corrected_count = arg_chunk_count + detail::calcAlignedOffset( arg_chunk_count, 8 );
-	chunk_size_ = ChunkSize;
-	chunk_count_ = corrected_count;
-	if( arg_allocator )
+	if( arg_capacity > SIZE_MAX / sizeof( T ) )
 	{
-		bitmap_ = static_cast< unsigned char* >( arg_allocator->Allocate( ( corrected_count / 8 ) * sizeof( char ) ) );
-		mem_pool_ = static_cast< detail::bitmapChunk<ChunkSize>* >( arg_allocator->Allocate( corrected_count * sizeof( detail::bitmapChunk<ChunkSize> ) ) );
+		HSA_ASSERT( false ) // allocation size overflows size_t
+		return false;
 	}
-	else
+	if( data_ != nullptr && allocator_->TryExpand( data_, capacity_ * sizeof( T ), arg_capacity * sizeof( T ) ) )
 	{
-#ifndef HSA_NO_MALLOC
-		bitmap_ = static_cast< unsigned char* >( malloc( ( corrected_count / 8 ) * sizeof( char ) ) );
-		mem_pool_ = static_cast< detail::bitmapChunk<ChunkSize>* >( malloc( corrected_count * sizeof( detail::bitmapChunk<ChunkSize> ) ) );
-#endif
-
+		capacity_ = arg_capacity;
+		return true;
 	}
-	HSA_ASSERT( mem_pool_ )
-	for( size_t i = 0, size_t = corrected_count / 8; i < 64; i++ )
+	T* data = static_cast< T* >( allocator_->TryAllocate( arg_capacity * sizeof( T ), alignof( T ) ) );
+	if( data == nullptr )
 	{
-		bitmap_[i] = 0b00000000;
+		return false;
 	}
-}
-template <size_t ChunkSize>
-BitmapAllocator<ChunkSize>::~BitmapAllocator()
-{
-	if( allocator_ )
+	if( std::is_trivially_copyable<T>::value )
 	{
-		allocator_->Free( mem_pool_ );
-		allocator_->Free( bitmap_ );
+		if( size_ != 0 )
+		{
+			memcpy( static_cast< void* >( data ), data_, size_ * sizeof( T ) );
+		}
 	}
 	else
 	{
-#ifndef HSA_NO_MALLOC
-		free( mem_pool_ );
-		free( bitmap_ );
-#endif // !HSA_NO_MALLOC
+		for( size_t i = 0; i < size_; i++ )
+		{
+			new( data + i ) T( std::move( data_[i] ) );
+			data_[i].~T();
+		}
 	}
-}
-template <size_t ChunkSize>
-inline void* BitmapAllocator<ChunkSize>::Allocate()
-{
-	void* return_ptr = nullptr;
-	size_t chunk_to_check = last_allocate_chunk + 1;
-	size_t startng_chunk = chunk_to_check;
-	if( chunk_to_check >= chunk_count_ )
+	if( data_ != nullptr )
 	{
-		chunk_to_check = 0;
+		allocator_->FreeSized( data_, capacity_ * sizeof( T ) );
 	}
-	bool chunk_allocated = false;
-	do
+	data_ = data;
+	capacity_ = arg_capacity;
+	return true;
+}
+#pragma endregion
+#pragma region FlatHashMapImplementation
+namespace detail
+{
+	/**
+	* @brief bit i is set if control byte i of the group equals the tag.
+	*/
+	inline uint32_t flatMapMatch( const int8_t* arg_group, int8_t arg_tag )
 	{
-		size_t bit_pos = ( chunk_to_check ) % 8;
-		size_t byte_pos = ( chunk_to_check ) / 8;
-
-		unsigned char bit_result = ( ( bitmap_[byte_pos] >> bit_pos ) & 0b00000001 );
-		if( !bit_result )
+#ifdef HSA_SSE2
+		__m128i group = _mm_load_si128( reinterpret_cast< const __m128i* >( arg_group ) );
+		return static_cast< uint32_t >( _mm_movemask_epi8( _mm_cmpeq_epi8( group, _mm_set1_epi8( arg_tag ) ) ) );
+#else
+		uint32_t mask = 0;
+		for( size_t i = 0; i < flat_map_group_size; i++ )
 		{
-			return_ptr = mem_pool_ + chunk_to_check; // getting allocation address
-			bitmap_[byte_pos] |= 0b00000001 << bit_pos;  // setting bit to 1
-			last_allocate_chunk = chunk_to_check;
-			chunk_allocated = true;
+			mask |= uint32_t( arg_group[i] == arg_tag ) << i;
 		}
-		else
+		return mask;
+#endif // HSA_SSE2
+	}
+	/**
+	* @brief bit i is set if slot i of the group is empty or deleted. only those control bytes have the high bit set.
+	*/
+	inline uint32_t flatMapMatchFree( const int8_t* arg_group )
+	{
+#ifdef HSA_SSE2
+		return static_cast< uint32_t >( _mm_movemask_epi8( _mm_load_si128( reinterpret_cast< const __m128i* >( arg_group ) ) ) );
+#else
+		uint32_t mask = 0;
+		for( size_t i = 0; i < flat_map_group_size; i++ )
 		{
-			chunk_to_check++;
-			if( chunk_to_check >= chunk_count_ )
-			{
-				chunk_to_check = 0;
-			}
-			if( startng_chunk == chunk_to_check )
-			{
-				HSA_ASSERT( false )
-			}
+			mask |= uint32_t( arg_group[i] < 0 ) << i;
 		}
-	} while( !chunk_allocated );
-
-	return return_ptr;
+		return mask;
+#endif // HSA_SSE2
+	}
 }
-template <size_t ChunkSize>
-inline void BitmapAllocator<ChunkSize>::Free( void* arg_ptr )
+template<class Key, class Value, class Hash, class KeyEqual>
+FlatHashMap<Key, Value, Hash, KeyEqual>::FlatHashMap( Allocator* arg_allocator, size_t arg_count ) :
+	allocator_( arg_allocator )
 {
-	detail::bitmapChunk<ChunkSize>* bm_ptr = reinterpret_cast< detail::bitmapChunk<ChunkSize>* >( arg_ptr );
-	size_t index = bm_ptr - mem_pool_;
-	size_t bit_pos = ( index ) % 8;
-	size_t byte_pos = ( index ) / 8;
-	bitmap_[byte_pos] &= ~( 0b00000001 << bit_pos );
+	HSA_ASSERT( allocator_ != nullptr );
+	if( arg_count != 0 )
+	{
+		Reserve( arg_count );
+	}
 }
-template <size_t ChunkSize>
-inline void BitmapAllocator<ChunkSize>::Reset()
+template<class Key, class Value, class Hash, class KeyEqual>
+FlatHashMap<Key, Value, Hash, KeyEqual>::FlatHashMap( FlatHashMap&& arg_other ) noexcept :
+	allocator_( arg_other.allocator_ ),
+	control_( arg_other.control_ ),
+	slots_( arg_other.slots_ ),
+	capacity_( arg_other.capacity_ ),
+	size_( arg_other.size_ ),
+	growth_left_( arg_other.growth_left_ )
+{
+	arg_other.control_ = nullptr;
+	arg_other.slots_ = nullptr;
+	arg_other.capacity_ = 0;
+	arg_other.size_ = 0;
+	arg_other.growth_left_ = 0;
+}
+template<class Key, class Value, class Hash, class KeyEqual>
+FlatHashMap<Key, Value, Hash, KeyEqual>& FlatHashMap<Key, Value, Hash, KeyEqual>::operator=( FlatHashMap&& arg_other ) noexcept
 {
-	for( size_t i = 0; i < chunk_count_ / 8; i++ )
+	if( this != &arg_other )
 	{
-		bitmap_[i] = 0b00000000;
+		this->~FlatHashMap();
+		new( this ) FlatHashMap( std::move( arg_other ) );
 	}
-	last_allocate_chunk = -1;
+	return *this;
 }
-#pragma endregion
-#pragma region FreeListAllocatorImplementation
-namespace detail
+template<class Key, class Value, class Hash, class KeyEqual>
+FlatHashMap<Key, Value, Hash, KeyEqual>::~FlatHashMap()
 {
-	inline bool Merge2ItrBlocks( OrderedList<FreeListHeader*>& arg_list, OrderedList<FreeListHeader*>::Iterator& arg_lhs,  OrderedList<FreeListHeader*>::Iterator& arg_rhs)
+	DestroySlots();
+	if( control_ != nullptr )
 	{
-		bool result = false;
-		if( arg_lhs != arg_list.End() && arg_rhs != arg_list.End() )
-		{
-			result = reinterpret_cast<void*>(reinterpret_cast<size_t>((*arg_lhs)->header_ptr_) + (*arg_lhs)->size_) == (*arg_rhs)->header_ptr_;
-			if( result )
-			{
-				( *arg_lhs )->size_ += ( *arg_rhs )->size_;
-				arg_list.Erase( ( *arg_rhs ) );
-			}
-		}
-		return result;
+		allocator_->FreeSized( control_, SlotOffset( capacity_ ) + capacity_ * sizeof( Slot ) );
 	}
 }
-FreeListAllocator::FreeListAllocator() 
+template<class Key, class Value, class Hash, class KeyEqual>
+inline Value* FlatHashMap<Key, Value, Hash, KeyEqual>::Find( const Key& arg_key )
 {
-#ifndef HSA_NO_MALLOC
-	mem_pool_ = static_cast< char* >( malloc( pool_size_ = MIBI( 50 ) ) );
-#endif
-	HSA_ASSERT( mem_pool_ );
-	Init();
+	size_t index = FindIndex( arg_key, HashOf( arg_key ) );
+	return index != SIZE_MAX ? &slots_[index].value_ : nullptr;
 }
-FreeListAllocator::FreeListAllocator( size_t arg_size, Allocator* arg_allocator ) :
-	allocator_( arg_allocator )
+template<class Key, class Value, class Hash, class KeyEqual>
+inline const Value* FlatHashMap<Key, Value, Hash, KeyEqual>::Find( const Key& arg_key ) const
 {
-	pool_size_ = arg_size;
-	if( arg_allocator )
+	size_t index = FindIndex( arg_key, HashOf( arg_key ) );
+	return index != SIZE_MAX ? &slots_[index].value_ : nullptr;
+}
+template<class Key, class Value, class Hash, class KeyEqual>
+inline bool FlatHashMap<Key, Value, Hash, KeyEqual>::Contains( const Key& arg_key ) const
+{
+	return FindIndex( arg_key, HashOf( arg_key ) ) != SIZE_MAX;
+}
+template<class Key, class Value, class Hash, class KeyEqual>
+template<class... Args>
+inline Value* FlatHashMap<Key, Value, Hash, KeyEqual>::Emplace( const Key& arg_key, Args&&... arg_args )
+{
+	bool inserted;
+	Slot* slot = FindOrInsert( arg_key, inserted, std::forward<Args>( arg_args )... );
+	return slot != nullptr ? &slot->value_ : nullptr;
+}
+template<class Key, class Value, class Hash, class KeyEqual>
+inline Value* FlatHashMap<Key, Value, Hash, KeyEqual>::Insert( const Key& arg_key, const Value& arg_value )
+{
+	bool inserted;
+	Slot* slot = FindOrInsert( arg_key, inserted, arg_value );
+	if( slot == nullptr )
 	{
-		mem_pool_ = static_cast< char* >( arg_allocator->Allocate( pool_size_, 16 ) );
+		return nullptr;
 	}
-	else
+	if( !inserted )
 	{
-#ifndef HSA_NO_MALLOC
-		mem_pool_ = static_cast< char* >( malloc( pool_size_ ) );
-#endif
+		slot->value_ = arg_value;
 	}
-	HSA_ASSERT( mem_pool_ );
-	Init();
+	return &slot->value_;
 }
-FreeListAllocator::~FreeListAllocator()
+template<class Key, class Value, class Hash, class KeyEqual>
+inline Value& FlatHashMap<Key, Value, Hash, KeyEqual>::operator[]( const Key& arg_key )
 {
-	free_list_->~OrderedList();
-	allocator_->Free( free_list_ );
-	if( has_custom_allocator_ == false )
+	bool inserted;
+	Slot* slot = FindOrInsert( arg_key, inserted );
+	HSA_ASSERT( slot != nullptr ) // out of memory
+	return slot->value_;
+}
+template<class Key, class Value, class Hash, class KeyEqual>
+inline bool FlatHashMap<Key, Value, Hash, KeyEqual>::Erase( const Key& arg_key )
+{
+	size_t index = FindIndex( arg_key, HashOf( arg_key ) );
+	if( index == SIZE_MAX )
 	{
-#ifndef HSA_NO_MALLOC
-		static_cast< MallocAllocator* >( allocator_ )->~MallocAllocator();
-		free( allocator_ );
-#endif // !HSA_NO_MALLOC
-		allocator_ = nullptr;
+		return false;
 	}
-	if( allocator_ )
+	slots_[index].~Slot();
+	--size_;
+	// a lookup stops at the first group with an empty slot. if the group already has one, no probe passes this group.
+	const int8_t* group = control_ + index / detail::flat_map_group_size * detail::flat_map_group_size;
+	if( detail::flatMapMatch( group, detail::flat_map_empty ) != 0 )
 	{
-		allocator_->Free( mem_pool_ );
+		control_[index] = detail::flat_map_empty;
+		++growth_left_;
 	}
 	else
 	{
-#ifndef HSA_NO_MALLOC
-		free( mem_pool_ );
-#endif // !HSA_NO_MALLOC
-
+		control_[index] = detail::flat_map_deleted;
 	}
+	return true;
 }
-inline void FreeListAllocator::Init()
+template<class Key, class Value, class Hash, class KeyEqual>
+inline void FlatHashMap<Key, Value, Hash, KeyEqual>::Clear()
 {
-	if( allocator_ == nullptr )
+	DestroySlots();
+	if( capacity_ != 0 )
 	{
-		has_custom_allocator_ = false;
-#ifndef HSA_NO_MALLOC
-		void* mem_block = malloc( sizeof( MallocAllocator ) );
-		allocator_ = new( mem_block ) MallocAllocator;
-#endif // !HSA_NO_MALLOC
+		memset( control_, detail::flat_map_empty, capacity_ );
 	}
-	else
+	size_ = 0;
+	growth_left_ = capacity_ / 8 * 7;
+}
+template<class Key, class Value, class Hash, class KeyEqual>
+inline bool FlatHashMap<Key, Value, Hash, KeyEqual>::Reserve( size_t arg_count )
+{
+	size_t capacity = detail::flat_map_group_size;
+	while( capacity / 8 * 7 < arg_count )
 	{
-		has_custom_allocator_ = true;
+		capacity *= 2;
 	}
-	HSA_ASSERT( allocator_ != nullptr );
-
-	free_list_ = new (allocator_->Allocate(sizeof(FreeList))) FreeList( allocator_ );
-	
-	free_list_->Insert( new(allocator_->Allocate(sizeof(detail::FreeListHeader))) detail::FreeListHeader(mem_pool_ , pool_size_ ));
+	return capacity <= capacity_ || Rehash( capacity );
 }
-inline void* FreeListAllocator::Allocate( size_t arg_size, size_t arg_alignment )
+template<class Key, class Value, class Hash, class KeyEqual>
+template<class Function>
+inline void FlatHashMap<Key, Value, Hash, KeyEqual>::ForEach( Function&& arg_function )
 {
-	FreeList::Iterator itr = free_list_->Begin();
-
-	while( itr != free_list_->End() )
+	for( size_t i = 0; i < capacity_; i++ )
 	{
-		auto* header = *itr;
-		size_t aligned_offset = detail::calcAlignedOffset( reinterpret_cast< size_t >( header->header_ptr_ ) + sizeof( detail::FreeListAllocationHeader ), arg_alignment );
-		size_t total_size = arg_size + sizeof( detail::FreeListAllocationHeader );
-		size_t total_aligned_size = total_size + aligned_offset;
-
-		if( header->size_ >= total_aligned_size )
+		if( control_[i] >= 0 )
 		{
-			free_list_->Erase( header );
-			char* raw_ptr = reinterpret_cast<char*>( header->header_ptr_ );
-			raw_ptr += aligned_offset;
-			detail::FreeListAllocationHeader* alloc_header = reinterpret_cast<detail::FreeListAllocationHeader*>( raw_ptr );
-			alloc_header->adjustment_ = aligned_offset;
-			alloc_header->size_ = arg_size;
-			raw_ptr += sizeof( detail::FreeListAllocationHeader );
-			if( header->size_ >= total_aligned_size + sizeof( detail::FreeListAllocationHeader ) + detail::FreeList::minimum_header_size )// split header.
-			{
-				free_list_->Insert( new( allocator_->Allocate( sizeof( detail::FreeListHeader ) ) )detail::FreeListHeader( raw_ptr + arg_size, header->size_ - total_aligned_size ) );
-
-			}
-			else if( header->size_ > total_aligned_size )// bigger than but not big enough.
-			{
-				alloc_header->size_ += header->size_ - total_aligned_size; // add remainder to the size so it does not get lost.
-			}
-			return raw_ptr;
+			arg_function( const_cast< const Key& >( slots_[i].key_ ), slots_[i].value_ );
 		}
-		++itr;
 	}
-	HSA_ASSERT( false ); // out of memory
-	return nullptr;;
 }
-inline void FreeListAllocator::Free( void* arg_ptr)
+template<class Key, class Value, class Hash, class KeyEqual>
+inline size_t FlatHashMap<Key, Value, Hash, KeyEqual>::Size() const
 {
-	char* raw_ptr = reinterpret_cast<char*>(arg_ptr);
-	raw_ptr -= sizeof( detail::FreeListAllocationHeader );
-	auto* alloc_header = reinterpret_cast< detail::FreeListAllocationHeader* >( raw_ptr );
-	raw_ptr -= alloc_header->adjustment_;
-	size_t mem_size = alloc_header->size_ + alloc_header->adjustment_ + sizeof( detail::FreeListAllocationHeader );
-	free_list_->Insert( new( allocator_->Allocate( sizeof( detail::FreeListHeader ) ) ) detail::FreeListHeader( raw_ptr, mem_size ) );
+	return size_;
 }
-inline void FreeListAllocator::Reset()
+template<class Key, class Value, class Hash, class KeyEqual>
+inline size_t FlatHashMap<Key, Value, Hash, KeyEqual>::Capacity() const
 {
-	free_list_->Clear();
-	free_list_->Insert( new( allocator_->Allocate( sizeof( detail::FreeListHeader ) ) ) detail::FreeListHeader( mem_pool_, pool_size_ ) );
+	return capacity_;
 }
-inline void FreeListAllocator::Defragment()
+template<class Key, class Value, class Hash, class KeyEqual>
+inline bool FlatHashMap<Key, Value, Hash, KeyEqual>::Empty() const
 {
-	auto itr = free_list_->Begin();
-	if( itr != free_list_->End() )
+	return size_ == 0;
+}
+template<class Key, class Value, class Hash, class KeyEqual>
+inline uint64_t FlatHashMap<Key, Value, Hash, KeyEqual>::HashOf( const Key& arg_key )
+{
+	// std::hash of an integer is often the integer itself. mixing spreads it over the tag and the group bits.
+	uint64_t hash = static_cast< uint64_t >( Hash()( arg_key ) ) * 0x9E3779B97F4A7C15ull;
+	return hash ^ ( hash >> 32 );
+}
+template<class Key, class Value, class Hash, class KeyEqual>
+template<class... Args>
+inline typename FlatHashMap<Key, Value, Hash, KeyEqual>::Slot* FlatHashMap<Key, Value, Hash, KeyEqual>::FindOrInsert( const Key& arg_key, bool& arg_inserted, Args&&... arg_args )
+{
+	uint64_t hash = HashOf( arg_key );
+	size_t index = FindIndex( arg_key, hash );
+	arg_inserted = index == SIZE_MAX;
+	if( !arg_inserted )
 	{
-		bool is_done = false;
-		while( is_done == false )
+		return &slots_[index];
+	}
+	index = capacity_ != 0 ? FindInsertIndex( hash ) : 0;
+	if( capacity_ == 0 || ( growth_left_ == 0 && control_[index] == detail::flat_map_empty ) )
+	{
+		// grow when 7 / 16 of the slots are used, half of the maximum load. otherwise the table is full of deleted slots,
+		// they are cleaned up in a table of the same size.
+		size_t capacity = capacity_ == 0 ? detail::flat_map_group_size : capacity_;
+		if( size_ >= capacity / 16 * 7 )
 		{
-			auto next = itr + 1;
-			if( next != free_list_->End() )
-			{
-				bool result = detail::Merge2ItrBlocks(*free_list_, itr, next);
-				if( result == false )
-				{
-					itr = next;
-				}
-			}
-			else
+			capacity *= 2;
+		}
+		if( !Rehash( capacity ) )
+		{
+			return nullptr;
+		}
+		index = FindInsertIndex( hash );
+	}
+	if( control_[index] == detail::flat_map_empty )
+	{
+		--growth_left_;
+	}
+	Slot* slot = new( slots_ + index ) Slot( arg_key, std::forward<Args>( arg_args )... );
+	control_[index] = static_cast< int8_t >( hash & 0x7F );
+	++size_;
+	return slot;
+}
+template<class Key, class Value, class Hash, class KeyEqual>
+inline size_t FlatHashMap<Key, Value, Hash, KeyEqual>::FindIndex( const Key& arg_key, uint64_t arg_hash ) const
+{
+	if( capacity_ == 0 )
+	{
+		return SIZE_MAX;
+	}
+	const size_t group_mask = capacity_ / detail::flat_map_group_size - 1;
+	const int8_t tag = static_cast< int8_t >( arg_hash & 0x7F );
+	size_t group = ( arg_hash >> 7 ) & group_mask;
+	// triangular probing visits every group once. the table always has empty slots, so the loop ends.
+	for( size_t step = 1;; step++ )
+	{
+		const int8_t* control = control_ + group * detail::flat_map_group_size;
+		for( uint32_t match = detail::flatMapMatch( control, tag ); match != 0; match &= match - 1 )
+		{
+			size_t index = group * detail::flat_map_group_size + detail::countTrailingZeros( match );
+			if( KeyEqual()( slots_[index].key_, arg_key ) )
 			{
-				is_done = true;
+				return index;
 			}
 		}
+		if( detail::flatMapMatch( control, detail::flat_map_empty ) != 0 )
+		{
+			return SIZE_MAX;
+		}
+		group = ( group + step ) & group_mask;
+	}
+}
+template<class Key, class Value, class Hash, class KeyEqual>
+inline size_t FlatHashMap<Key, Value, Hash, KeyEqual>::FindInsertIndex( uint64_t arg_hash ) const
+{
+	const size_t group_mask = capacity_ / detail::flat_map_group_size - 1;
+	size_t group = ( arg_hash >> 7 ) & group_mask;
+	for( size_t step = 1;; step++ )
+	{
+		uint32_t free_slots = detail::flatMapMatchFree( control_ + group * detail::flat_map_group_size );
+		if( free_slots != 0 )
+		{
+			return group * detail::flat_map_group_size + detail::countTrailingZeros( free_slots );
+		}
+		group = ( group + step ) & group_mask;
+	}
+}
+template<class Key, class Value, class Hash, class KeyEqual>
+inline bool FlatHashMap<Key, Value, Hash, KeyEqual>::Rehash( size_t arg_capacity )
+{
+	if( arg_capacity > ( SIZE_MAX - SlotOffset( arg_capacity ) ) / sizeof( Slot ) )
+	{
+		HSA_ASSERT( false ) // allocation size overflows size_t
+		return false;
+	}
+	size_t alignment = alignof( Slot ) > detail::flat_map_group_size ? alignof( Slot ) : detail::flat_map_group_size;
+	int8_t* control = static_cast< int8_t* >( allocator_->TryAllocate( SlotOffset( arg_capacity ) + arg_capacity * sizeof( Slot ), alignment ) );
+	if( control == nullptr )
+	{
+		return false;
+	}
+	memset( control, detail::flat_map_empty, arg_capacity );
+
+	int8_t* old_control = control_;
+	Slot* old_slots = slots_;
+	size_t old_capacity = capacity_;
+	control_ = control;
+	slots_ = reinterpret_cast< Slot* >( control + SlotOffset( arg_capacity ) );
+	capacity_ = arg_capacity;
+	growth_left_ = arg_capacity / 8 * 7 - size_;
+	for( size_t i = 0; i < old_capacity; i++ )
+	{
+		if( old_control[i] >= 0 )
+		{
+			size_t index = FindInsertIndex( HashOf( old_slots[i].key_ ) );
+			new( slots_ + index ) Slot( std::move( old_slots[i] ) );
+			control_[index] = old_control[i];
+			old_slots[i].~Slot();
+		}
+	}
+	if( old_control != nullptr )
+	{
+		allocator_->FreeSized( old_control, SlotOffset( old_capacity ) + old_capacity * sizeof( Slot ) );
+	}
+	return true;
+}
+template<class Key, class Value, class Hash, class KeyEqual>
+inline void FlatHashMap<Key, Value, Hash, KeyEqual>::DestroySlots()
+{
+	if( std::is_trivially_destructible<Slot>::value )
+	{
+		return;
+	}
+	for( size_t i = 0; i < capacity_; i++ )
+	{
+		if( control_[i] >= 0 )
+		{
+			slots_[i].~Slot();
+		}
 	}
 }
+template<class Key, class Value, class Hash, class KeyEqual>
+inline size_t FlatHashMap<Key, Value, Hash, KeyEqual>::SlotOffset( size_t arg_capacity )
+{
+	return ( arg_capacity + alignof( Slot ) - 1 ) / alignof( Slot ) * alignof( Slot );
+}
 #pragma endregion
 #endif // HSA_IMPLEMENTATION